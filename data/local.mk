@@ -49,6 +49,24 @@ dist_m4sugar_DATA =                             \
   data/m4sugar/foreach.m4                       \
   data/m4sugar/m4sugar.m4
 
+# A frozen state of m4sugar, which bison reloads instead of reading
+# m4sugar.m4 each time it runs m4.  It depends on the version of m4, so
+# it is built, not distributed.
+nodist_m4sugar_DATA = data/m4sugar/m4sugar.m4f
+CLEANFILES += data/m4sugar/m4sugar.m4f
+data/m4sugar/m4sugar.m4f: $(dist_m4sugar_DATA)
+	$(AM_V_GEN)$(MKDIR_P) data/m4sugar
+	$(AM_V_at)$(M4) $(M4_GNU) -I $(srcdir)/data --freeze-state=$@.tmp \
+	  $(srcdir)/data/m4sugar/m4sugar.m4 </dev/null
+	$(AM_V_at)mv $@.tmp $@
+
+# bison ignores the frozen state if it is older than m4sugar.m4, and
+# install does not preserve time stamps.
+install-data-hook: install-frozen-m4sugar
+.PHONY: install-frozen-m4sugar
+install-frozen-m4sugar:
+	touch $(DESTDIR)$(m4sugardir)/m4sugar.m4f
+
 xsltdir = $(pkgdatadir)/xslt
 dist_xslt_DATA =                                \
   data/xslt/bison.xsl                           \
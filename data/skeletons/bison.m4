@@ -282,6 +282,16 @@ m4_define([_b4_join],
 
 
 
+# b4_table_encoding_case(PACKED, DENSE, TWO-LEVEL)
+# ------------------------------------------------
+# Expand the argument corresponding to %define api.table.encoding.
+m4_define([b4_table_encoding_case],
+[m4_case(b4_percent_define_get([[api.table.encoding]]),
+         [dense],     [$2],
+         [two-level], [$3],
+         [$1])])
+
+
 # b4_integral_parser_tables_map(MACRO)
 # -------------------------------------
 # Map MACRO on all the integral tables.  MACRO is expected to have
@@ -306,7 +316,22 @@ positive, shift that token.  If negative, reduce the rule whose
 number is the opposite.  If YYTABLE_NINF, syntax error.]])
 
 $1([check], [b4_check])
-
+b4_table_encoding_case([],
+[
+$1([action], [b4_action],
+   [[YYACTION[STATE-NUM * YYNTOKENS + TOKEN-NUM] -- What to do in state
+STATE-NUM on TOKEN-NUM, encoded as in YYTABLE.  Zero means the default
+action, YYDEFACT[STATE-NUM].]])
+],
+[
+$1([action], [b4_action],
+   [[YYACTION[YYACTROW[STATE-NUM] * YYNTOKENS + TOKEN-NUM] -- What to do
+in state STATE-NUM on TOKEN-NUM, encoded as in YYTABLE.  Zero means the
+default action, YYDEFACT[STATE-NUM].]])
+
+$1([actrow], [b4_actrow],
+   [[YYACTROW[STATE-NUM] -- The row of YYACTION for state STATE-NUM.]])
+])
 $1([stos], [b4_stos],
    [[YYSTOS[STATE-NUM] -- The (internal number of the) accessing
 symbol of state STATE-NUM.]])
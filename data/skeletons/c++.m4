@@ -384,7 +384,26 @@ m4_define([b4_symbol_type_define],
 
       /// Constructor for valueless symbols, and symbols from each type.
 ]b4_type_foreach([_b4_token_constructor_define])dnl
-    ])[};
+    ], [[
+      /// Superclass.
+      typedef basic_symbol<by_type> super_type;
+
+      /// Empty symbol.
+      symbol_type () {}
+
+      /// Constructor for valueless symbols.
+      symbol_type (int tok]b4_locations_if([, YY_COPY (location_type) l])[)
+        : super_type (token_type (tok), semantic_type ()]b4_locations_if([,
+                      YY_MOVE (l)])[)
+      {}
+
+      /// Constructor for symbols with semantic value.
+      symbol_type (int tok, YY_COPY (semantic_type) v]b4_locations_if([,
+                   YY_COPY (location_type) l])[)
+        : super_type (token_type (tok), YY_MOVE (v)]b4_locations_if([,
+                      YY_MOVE (l)])[)
+      {}
+    ]])[};
 ]])
 
 
@@ -449,10 +468,11 @@ m4_define([b4_public_types_define],
   void
   ]b4_parser_class[::basic_symbol<Base>::move (basic_symbol& s)
   {
-    super_type::move (s);
-    ]b4_variant_if([b4_symbol_variant([this->type_get ()], [value], [move],
+    // Transfer the value first: if it throws, S keeps it.
+    ]b4_variant_if([b4_symbol_variant([s.type_get ()], [value], [move],
                                       [YY_MOVE (s.value)])],
-                   [value = YY_MOVE (s.value);])[]b4_locations_if([
+                   [value = YY_MOVE (s.value);])[
+    super_type::move (s);]b4_locations_if([
     location = YY_MOVE (s.location);])[
   }
 
@@ -23,6 +23,9 @@
 m4_if(b4_skeleton, ["glr.c"],
       [m4_include(b4_skeletonsdir/[c.m4])])
 
+# Only the packed parser tables are supported.
+b4_percent_define_check_values([[[[api.table.encoding]], [[packed]]]])
+
 
 ## ---------------- ##
 ## Default values.  ##
@@ -29,6 +29,70 @@ m4_define([b4_lac_flag],
           [m4_if(b4_percent_define_get([[parse.lac]]),
                  [none], [[0]], [[1]])])
 
+## ------------ ##
+## api.stack.  ##
+## ------------ ##
+
+# The stack is created with room for api.stack.initial-depth symbols.
+# With api.stack.inline, this room is part of the parser object itself.
+b4_percent_define_default([[api.stack.initial-depth]], [[200]])
+m4_if(m4_bregexp(b4_percent_define_get([[api.stack.initial-depth]]),
+                 [^[	 ]*[0-9]+[	 ]*$]), [-1],
+[b4_complain_at(b4_percent_define_get_loc([[api.stack.initial-depth]]),
+                [[invalid value for %%define variable '%s': '%s']],
+                [api.stack.initial-depth],
+                m4_dquote(b4_percent_define_get([[api.stack.initial-depth]])))])
+b4_percent_define_if_define([stack_inline], [api.stack.inline])
+
+# b4_stack_inline_depth
+# ---------------------
+# The number of symbols stored in the stack object.
+m4_define([b4_stack_inline_depth],
+[b4_stack_inline_if([b4_percent_define_get([[api.stack.initial-depth]])],
+                    [0])])
+
+
+## --------------- ##
+## api.allocator.  ##
+## --------------- ##
+
+# With %define api.allocator {ALLOCATOR}, the memory of the parser (its
+# stacks and its error messages) is obtained from ALLOCATOR, rebound to
+# the needed types.  The constructor takes it as last argument.
+# Requires C++11.
+b4_percent_define_check_kind([api.allocator], [code], [deprecated])
+b4_define_flag_if([allocator])
+b4_percent_define_ifdef([[api.allocator]],
+                        [m4_define([b4_allocator_flag], [[1]])],
+                        [m4_define([b4_allocator_flag], [[0]])])
+
+
+## --------------- ##
+## api.push-pull.  ##
+## --------------- ##
+
+# In addition to the values supported by yacc.c, 'coroutine' makes
+# parse a C++20 coroutine that co_awaits the tokens from yylex and feeds
+# them to push_parse.  In other words, it is 'both', with co_await.
+b4_percent_define_default([[api.push-pull]], [[pull]])
+b4_percent_define_check_values([[[[api.push-pull]],
+                                 [[pull]], [[push]], [[both]], [[coroutine]]]])
+b4_define_flag_if([pull]) m4_define([b4_pull_flag], [[1]])
+b4_define_flag_if([push]) m4_define([b4_push_flag], [[1]])
+b4_define_flag_if([coroutine]) m4_define([b4_coroutine_flag], [[0]])
+m4_case(b4_percent_define_get([[api.push-pull]]),
+        [pull], [m4_define([b4_push_flag], [[0]])],
+        [push], [m4_define([b4_pull_flag], [[0]])],
+        [coroutine], [m4_define([b4_coroutine_flag], [[1]])])
+
+# Handle BISON_USE_PUSH_FOR_PULL for the test suite.  So that push parsing
+# tests function as written, do not let BISON_USE_PUSH_FOR_PULL modify the
+# behavior of Bison at all when push parsing is already requested.
+b4_define_flag_if([use_push_for_pull])
+b4_use_push_for_pull_if([
+  b4_push_if([m4_define([b4_use_push_for_pull_flag], [[0]])],
+             [m4_define([b4_push_flag], [[1]])])])
+
 
 # b4_tname_if(TNAME-NEEDED, TNAME-NOT-NEEDED)
 # -------------------------------------------
@@ -139,14 +203,49 @@ b4_dollar_popdef[]dnl
 ])])
 
 
+# b4_parse_type
+# -------------
+# The type returned by parse, in the parser class.
+m4_define([b4_parse_type],
+[b4_coroutine_if([task], [int])])
+
+
+## ---------------- ##
+## api.lexer.type.  ##
+## ---------------- ##
+
+# With %define api.lexer.type {LEXER}, the parser is given a reference
+# to the scanner, an object of type LEXER, and calls it instead of
+# yylex.  Since this type is known, its call operator can be inlined
+# in the parser.  The reference is handled as a %parse-param, which
+# comes first.
+b4_percent_define_check_kind([api.lexer.type], [code], [deprecated])
+b4_percent_define_ifdef([[api.lexer.type]],
+[m4_define([b4_lexer_type], b4_percent_define_get([[api.lexer.type]]))
+m4_ifset([b4_parse_param],
+[m4_define([b4_parse_param],
+           [[[[]b4_lexer_type[& yylexer]], [[yylexer]]],]
+m4_defn([b4_parse_param]))],
+[m4_define([b4_parse_param],
+           [[[[]b4_lexer_type[& yylexer]], [[yylexer]]]])])])
+
+
+# b4_lex_function
+# ---------------
+# The function called to get a token: yylex, or the api.lexer.type
+# object.
+m4_define([b4_lex_function],
+[m4_ifdef([b4_lexer_type], [yylexer], [yylex])])
+
+
 # b4_lex
 # ------
 # Call yylex.
 m4_define([b4_lex],
 [b4_token_ctor_if(
-[b4_function_call([yylex],
+[b4_function_call(b4_lex_function,
                   [symbol_type], m4_ifdef([b4_lex_param], b4_lex_param))],
-[b4_function_call([yylex], [int],
+[b4_function_call(b4_lex_function, [int],
                   [b4_api_PREFIX[STYPE*], [&yyla.value]][]dnl
 b4_locations_if([, [[location*], [&yyla.location]]])dnl
 m4_ifdef([b4_lex_param], [, ]b4_lex_param))])])
@@ -174,10 +273,15 @@ m4_define([b4_shared_declarations],
 ]b4_parse_assert_if([# include <cassert>])[
 # include <cstdlib> // std::abort
 # include <iostream>
+# include <memory> // std::allocator
+# include <new> // placement new
 # include <stdexcept>
 # include <string>
+# include <utility> // std::move_if_noexcept
 # include <vector>
-
+]b4_coroutine_if([[# include <coroutine>
+# include <exception>
+]])[
 ]b4_cxx_portability[
 ]m4_ifdef([b4_location_include],
           [[# include ]b4_location_include])[
@@ -187,6 +291,15 @@ m4_define([b4_shared_declarations],
 ]b4_cast_define[
 ]b4_null_define[
 
+// Whether we are compiled with exception support.
+#ifndef YY_EXCEPTIONS
+# if defined __GNUC__ && !defined __EXCEPTIONS
+#  define YY_EXCEPTIONS 0
+# else
+#  define YY_EXCEPTIONS 1
+# endif
+#endif
+
 ]b4_YYDEBUG_define[
 
 ]b4_namespace_open[
@@ -199,18 +312,136 @@ m4_define([b4_shared_declarations],
   {
   public:
 ]b4_public_types_declare[
-]b4_symbol_type_define[
+]b4_symbol_type_define[]b4_allocator_if([[
+    /// The allocator of the memory of the parser.
+    typedef ]b4_percent_define_get([[api.allocator]])[ allocator_type;
+
+    /// The allocator of objects of type T.
+    template <typename T>
+    using rebind_alloc
+      = typename std::allocator_traits<allocator_type>::template rebind_alloc<T>;
+
+    /// The type of the error messages.
+    typedef std::basic_string<char, std::char_traits<char>, rebind_alloc<char> >
+      string_type;]], [[
+    /// The type of the error messages.
+    typedef std::string string_type;]])[
+
     /// Build a parser object.
-    ]b4_parser_class[ (]b4_parse_param_decl[);
+    ]b4_parser_class[ (]b4_parse_param_decl[]b4_allocator_if([m4_ifset([b4_parse_param], [, ])[const allocator_type& yyalloc = allocator_type ()]])[);
     virtual ~]b4_parser_class[ ();
+]b4_coroutine_if([[
+    /// The coroutine returned by parse ().
+    ///
+    /// It starts suspended: the parse begins when the task is awaited,
+    /// or resumed.  The parser must outlive it.
+    class task
+    {
+    public:
+      struct promise_type
+      {
+        task get_return_object ()
+        {
+          return task (std::coroutine_handle<promise_type>::from_promise (*this));
+        }
+
+        std::suspend_always initial_suspend () noexcept { return {}; }
+
+        /// Resume the coroutine awaiting the parse, if there is one.
+        struct final_awaiter
+        {
+          bool await_ready () noexcept { return false; }
+
+          std::coroutine_handle<>
+          await_suspend (std::coroutine_handle<promise_type> h) noexcept
+          {
+            std::coroutine_handle<> c = h.promise ().continuation;
+            return c ? c : std::noop_coroutine ();
+          }
+
+          void await_resume () noexcept {}
+        };
 
+        final_awaiter final_suspend () noexcept { return {}; }
+
+        void return_value (int r) { result = r; }
+
+        void unhandled_exception () { exception = std::current_exception (); }
+
+        /// The value returned by parse ().
+        int result = 1;
+        /// The exception that escaped from parse (), if any.
+        std::exception_ptr exception;
+        /// The coroutine awaiting the parse, if any.
+        std::coroutine_handle<> continuation;
+      };
+
+      task (task&& that) noexcept
+        : handle_ (that.handle_)
+      {
+        that.handle_ = nullptr;
+      }
+
+      ~task ()
+      {
+        if (handle_)
+          handle_.destroy ();
+      }
+
+      /// Whether the parse is complete.
+      bool done () const { return handle_.done (); }
+
+      /// Run the parse until it awaits a token that is not ready yet,
+      /// or completes.
+      void resume () { handle_.resume (); }
+
+      /// The result of a complete parse: 0 iff parsing succeeded.
+      /// Rethrow the exception that escaped from the parse, if any.
+      int result () const
+      {
+        if (handle_.promise ().exception)
+          std::rethrow_exception (handle_.promise ().exception);
+        return handle_.promise ().result;
+      }
+
+      bool await_ready () const noexcept { return handle_.done (); }
+
+      std::coroutine_handle<>
+      await_suspend (std::coroutine_handle<> c) noexcept
+      {
+        handle_.promise ().continuation = c;
+        return handle_;
+      }
+
+      int await_resume () const { return result (); }
+
+    private:
+      explicit task (std::coroutine_handle<promise_type> h)
+        : handle_ (h)
+      {}
+
+      std::coroutine_handle<promise_type> handle_;
+    };
+]])b4_pull_if([[
     /// Parse.  An alias for parse ().
-    /// \returns  0 iff parsing succeeded.
-    int operator() ();
+    /// \returns  0 iff parsing succeeded.]b4_coroutine_if([[
+    ///           The parse is run when the task is awaited.]])[
+    ]b4_parse_type[ operator() ();
 
     /// Parse.
-    /// \returns  0 iff parsing succeeded.
-    virtual int parse ();
+    /// \returns  0 iff parsing succeeded.]b4_coroutine_if([[
+    ///           The parse is run when the task is awaited.]])[
+    virtual ]b4_parse_type[ parse ();
+]])b4_push_if([[
+    /// Value returned by push_parse when it needs more tokens.
+    enum { push_more = 4 };
+
+    /// Push a token, and run the analysis until another one is needed.
+    /// \param yytoken  the next token (its contents are stolen).
+    /// \returns  push_more if more tokens are needed, 0 if parsing
+    ///           succeeded, 1 otherwise.
+    virtual int push_parse (YY_MOVE_REF (symbol_type) yytoken);
+]])[
 
 #if ]b4_api_PREFIX[DEBUG
     /// The current debugging stream.
@@ -229,11 +460,14 @@ m4_define([b4_shared_declarations],
     /// Report a syntax error.]b4_locations_if([[
     /// \param loc    where the syntax error is found.]])[
     /// \param msg    a description of the syntax error.
-    virtual void error (]b4_locations_if([[const location_type& loc, ]])[const std::string& msg);
+    virtual void error (]b4_locations_if([[const location_type& loc, ]])[const string_type& msg);
 
     /// Report a syntax error.
     void error (const syntax_error& err);
-
+]b4_allocator_if([[
+    /// The allocator of the memory of the parser.
+    allocator_type get_allocator () const;
+]])[
 ]b4_token_constructor_define[
 ]b4_parse_error_bmatch([custom\|detailed\|verbose], [[
     class context
@@ -275,7 +509,7 @@ m4_define([b4_shared_declarations],
 ]b4_parse_error_bmatch([detailed\|verbose], [[
     /// Generate an error message.
     /// \param yyctx     the context in which the error occurred.
-    virtual std::string yysyntax_error_ (const context& yyctx) const;
+    virtual string_type yysyntax_error_ (const context& yyctx) const;
 ]])b4_parse_error_bmatch([custom], [[
     /// Report a syntax error
     /// \param yyctx     the context in which the error occurred.
@@ -311,7 +545,7 @@ m4_define([b4_shared_declarations],
 ]b4_parser_tables_declare[
 ]b4_parse_error_case([verbose], [[
     /// Convert the symbol name \a n to a form suitable for a diagnostic.
-    static std::string yytnamerr_ (const char *n);
+    string_type yytnamerr_ (const char *n) const;
 
     /// For a symbol, its name in clear.
     static const char* const yytname_[];
@@ -410,7 +644,8 @@ m4_define([b4_shared_declarations],
 ]b4_stack_define[
 
     /// Stack type.
-    typedef stack<stack_symbol_type> stack_type;
+    typedef stack<stack_symbol_type, ]b4_stack_inline_depth[]b4_allocator_if([,
+                  rebind_alloc<stack_symbol_type> ])[> stack_type;
 
     /// The stack.
     stack_type yystack_;]b4_lac_if([[
@@ -419,9 +654,20 @@ m4_define([b4_shared_declarations],
     /// yy_lac_check_. We just store it as a member of this class to hold
     /// on to the memory and to avoid frequent reallocations.
     /// Since yy_lac_check_ is const, this member must be mutable.
-    mutable std::vector<state_type> yylac_stack_;
+    mutable std::vector<state_type]b4_allocator_if([, rebind_alloc<state_type> ])[> yylac_stack_;
     /// Whether an initial LAC context was established.
     bool yy_lac_established_;
+]])b4_push_if([[
+    /// Whether the next call to push_parse starts a new parse.
+    bool yynew_;
+    /// Number of syntax errors reported so far.
+    int yynerrs_;
+    /// Number of tokens to shift before error messages are enabled.
+    int yyerrstatus_;
+    /// The lookahead symbol, preserved between calls to push_parse.
+    symbol_type yyla_;]b4_locations_if([[
+    /// The locations where the error started and ended.
+    stack_symbol_type yyerror_range_[3];]])[
 ]])[
 
     /// Push a new state on the stack.
@@ -526,15 +772,6 @@ m4_if(b4_prefix, [yy], [],
 # endif
 #endif
 
-// Whether we are compiled with exception support.
-#ifndef YY_EXCEPTIONS
-# if defined __GNUC__ && !defined __EXCEPTIONS
-#  define YY_EXCEPTIONS 0
-# else
-#  define YY_EXCEPTIONS 1
-# endif
-#endif
-
 ]b4_locations_if([dnl
 [#define YYRHSLOC(Rhs, K) ((Rhs)[K].location)
 ]b4_yylloc_default_define])[
@@ -613,12 +850,12 @@ b4_parse_error_case([verbose], [[
      that double-quoting is unnecessary unless the string contains an
      apostrophe, a comma, or backslash (other than backslash-backslash).
      YYSTR is taken from yytname.  */
-  std::string
-  ]b4_parser_class[::yytnamerr_ (const char *yystr)
+  ]b4_parser_class[::string_type
+  ]b4_parser_class[::yytnamerr_ (const char *yystr) const
   {
     if (*yystr == '"')
       {
-        std::string yyr;
+        string_type yyr]b4_allocator_if([ (get_allocator ())])[;
         char const *yyp = yystr;
 
         for (;;)
@@ -645,20 +882,24 @@ b4_parse_error_case([verbose], [[
       do_not_strip_quotes: ;
       }
 
-    return yystr;
+    return ]b4_allocator_if([string_type (yystr, get_allocator ())],
+                            [yystr])[;
   }
 ]])[
 
   /// Build a parser object.
-  ]b4_parser_class::b4_parser_class[ (]b4_parse_param_decl[)
+  ]b4_parser_class::b4_parser_class[ (]b4_parse_param_decl[]b4_allocator_if([m4_ifset([b4_parse_param], [, ])[const allocator_type& yyalloc]])[)
+    :
 #if ]b4_api_PREFIX[DEBUG
-    : yydebug_ (false),
-      yycdebug_ (&std::cerr)]b4_lac_if([,], [m4_ifset([b4_parse_param], [,])])[
-#else
-]b4_lac_if([    :], [m4_ifset([b4_parse_param], [    :])])[
-#endif]b4_lac_if([[
-      yy_lac_established_ (false)]m4_ifset([b4_parse_param], [,])])[]b4_parse_param_cons[
-  {}
+      yydebug_ (false),
+      yycdebug_ (&std::cerr),
+#endif
+      yystack_ (]b4_percent_define_get([[api.stack.initial-depth]])[]b4_allocator_if([, yyalloc])[)]b4_lac_if([[,]b4_allocator_if([[
+      yylac_stack_ (yyalloc),]])[
+      yy_lac_established_ (false)]])m4_ifset([b4_parse_param], [,])[]b4_parse_param_cons[
+  {]b4_push_if([[
+    yynew_ = true;
+  ]])[}
 
   ]b4_parser_class::~b4_parser_class[ ()
   {}
@@ -711,10 +952,13 @@ b4_parse_error_case([verbose], [[
   {}
 
   ]b4_parser_class[::stack_symbol_type::stack_symbol_type (YY_RVREF (stack_symbol_type) that)
-    : super_type (YY_MOVE (that.state)]b4_variant_if([], [, YY_MOVE (that.value)])b4_locations_if([, YY_MOVE (that.location)])[)
+    : super_type (]b4_variant_if([empty_state],
+                                 [YY_MOVE (that.state), YY_MOVE (that.value)])[]b4_locations_if([, YY_MOVE (that.location)])[)
   {]b4_variant_if([
     b4_symbol_variant([that.type_get ()],
-                      [value], [YY_MOVE_OR_COPY], [YY_MOVE (that.value)])])[
+                      [value], [YY_MOVE_OR_COPY], [YY_MOVE (that.value)])
+    // Empty until the value is built, in case it throws.
+    state = that.state;])[
 #if 201103L <= YY_CPLUSPLUS
     // that is emptied.
     that.state = empty_state;
@@ -722,10 +966,12 @@ b4_parse_error_case([verbose], [[
   }
 
   ]b4_parser_class[::stack_symbol_type::stack_symbol_type (state_type s, YY_MOVE_REF (symbol_type) that)
-    : super_type (s]b4_variant_if([], [, YY_MOVE (that.value)])[]b4_locations_if([, YY_MOVE (that.location)])[)
+    : super_type (]b4_variant_if([empty_state], [s, YY_MOVE (that.value)])[]b4_locations_if([, YY_MOVE (that.location)])[)
   {]b4_variant_if([
     b4_symbol_variant([that.type_get ()],
-                      [value], [move], [YY_MOVE (that.value)])])[
+                      [value], [move], [YY_MOVE (that.value)])
+    // Empty until the value is built, in case it throws.
+    state = s;])[
     // that is emptied.
     that.type = empty_symbol;
   }
@@ -802,7 +1048,10 @@ b4_parse_error_case([verbose], [[
   ]b4_parser_class[::yypush_ (const char* m, state_type s, YY_MOVE_REF (symbol_type) sym)
   {
 #if 201103L <= YY_CPLUSPLUS
-    yypush_ (m, stack_symbol_type (s, std::move (sym)));
+    // Build the symbol directly on the stack.
+    yystack_.emplace (s, std::move (sym));
+    if (m)
+      YY_SYMBOL_PRINT (m, yystack_[0]);
 #else
     stack_symbol_type ss (s, sym);
     yypush_ (m, ss);
@@ -864,13 +1113,79 @@ b4_parse_error_case([verbose], [[
     return yyvalue == yytable_ninf_;
   }
 
-  int
+]b4_pull_if([[  ]b4_coroutine_if([b4_parser_class[::task]], [[int]])[
   ]b4_parser_class[::operator() ()
   {
     return parse ();
   }
 
-  int
+]])b4_push_if([b4_pull_if([[  ]b4_coroutine_if([b4_parser_class[::task]], [[int]])[
+  ]b4_parser_class[::parse ()
+  {
+    int yystatus;
+    do
+      {
+        symbol_type yyla;
+#if YY_EXCEPTIONS
+        try
+#endif // YY_EXCEPTIONS
+          {]b4_token_ctor_if([[
+            symbol_type yylookahead (]b4_coroutine_if([co_await ])b4_lex[);
+            yyla.move (yylookahead);]], [[
+            yyla.type = yytranslate_ (]b4_coroutine_if([co_await ])b4_lex[);]])[
+          }
+#if YY_EXCEPTIONS
+        catch (const syntax_error& yyexc)
+          {
+            YYCDEBUG << "Caught exception: " << yyexc.what() << '\n';
+            error (yyexc);
+            // Have push_parse enter error recovery.
+            yyla.clear ();
+            yyla.type = yy_error_token_;
+          }
+#endif // YY_EXCEPTIONS
+        yystatus = push_parse (YY_MOVE (yyla));
+      }
+    while (yystatus == push_more);
+    ]b4_coroutine_if([co_return], [return])[ yystatus;
+  }
+
+]])[  int
+  ]b4_parser_class[::push_parse (YY_MOVE_REF (symbol_type) yytoken)
+  {
+    int yyn;
+    /// Length of the RHS of the rule being reduced.
+    int yylen = 0;
+
+    /// The lookahead symbol.
+    symbol_type& yyla = yyla_;]b4_locations_if([[
+
+    /// The locations where the error started and ended.
+    stack_symbol_type (&yyerror_range)[3] = yyerror_range_;]])[
+
+    /// The return value of push_parse ().
+    int yyresult;
+
+#if YY_EXCEPTIONS
+    try
+#endif // YY_EXCEPTIONS
+      {
+    if (!yynew_)
+      {
+        yyn = yypact_[+yystack_[0].state];
+        goto yyread_pushed_token;
+      }
+
+    yynerrs_ = 0;
+    yyerrstatus_ = 0;]b4_lac_if([[
+
+    /// Discard the LAC context in case there still is one left from a
+    /// previous invocation.
+    yy_lac_discard_ ("init");]])[
+
+    YYCDEBUG << "Starting parse\n";
+]],
+[[  int
   ]b4_parser_class[::parse ()
   {
     int yyn;
@@ -899,6 +1214,7 @@ b4_parse_error_case([verbose], [[
 #endif // YY_EXCEPTIONS
       {
     YYCDEBUG << "Starting parse\n";
+]])[
 
 ]m4_ifdef([b4_initial_action], [
 b4_dollar_pushdef([yyla.value], [], [], [yyla.location])dnl
@@ -937,7 +1253,24 @@ b4_dollar_popdef])[]dnl
 
     // Read a lookahead token.
     if (yyla.empty ())
-      {
+      {]b4_push_if([[
+        if (!yynew_)
+          {
+            YYCDEBUG << "Return for a new token:\n";
+            yyresult = push_more;
+            goto yypushreturn;
+          }
+        yynew_ = false;
+
+      yyread_pushed_token:
+        YYCDEBUG << "Reading a token\n";
+        yyla.move (yytoken);
+        if (yyla.type_get () == yy_error_token_)
+          {
+            // The token was replaced by an error: recover from it.
+            yyla.clear ();
+            goto yyerrlab1;
+          }]], [[
         YYCDEBUG << "Reading a token\n";
 #if YY_EXCEPTIONS
         try
@@ -954,22 +1287,27 @@ b4_dollar_popdef])[]dnl
             error (yyexc);
             goto yyerrlab1;
           }
-#endif // YY_EXCEPTIONS
+#endif // YY_EXCEPTIONS]])[
       }
     YY_SYMBOL_PRINT ("Next token is", yyla);
 
     /* If the proper action on seeing token YYLA.TYPE is to reduce or
        to detect an error, take that action.  */
-    yyn += yyla.type_get ();
-    if (yyn < 0 || yylast_ < yyn || yycheck_[yyn] != yyla.type_get ())
+]b4_table_encoding_case([[    yyn += yyla.type_get ();
+    if (yyn < 0 || yylast_ < yyn || yycheck_[yyn] != yyla.type_get ())]],
+[[    yyn = yyaction_[+yystack_[0].state * yyntokens_ + yyla.type_get ()];
+    if (yyn == 0)]],
+[[    yyn = yyaction_[yyactrow_[+yystack_[0].state] * yyntokens_
+                    + yyla.type_get ()];
+    if (yyn == 0)]])[
       {]b4_lac_if([[
         if (!yy_lac_establish_ (yyla.type_get ()))
            goto yyerrlab;]])[
         goto yydefault;
       }
 
-    // Reduce or error.
-    yyn = yytable_[yyn];
+    // Reduce or error.]b4_table_encoding_case([[
+    yyn = yytable_[yyn];]])[
     if (yyn <= 0)
       {
         if (yy_table_value_is_error_ (yyn))
@@ -1072,14 +1410,14 @@ b4_dollar_popdef])[]dnl
       {
         ++yynerrs_;]b4_parse_error_case(
                   [simple], [[
-        std::string msg = YY_("syntax error");
+        string_type msg (YY_("syntax error")]b4_allocator_if([, get_allocator ()])[);
         error (]b4_join(b4_locations_if([yyla.location]), [[YY_MOVE (msg)]])[);]],
                   [custom], [[
         context yyctx (*this, yyla);
         yyreport_syntax_error (yyctx);]],
                   [[
         context yyctx (*this, yyla);
-        std::string msg = yysyntax_error_ (yyctx);
+        string_type msg = yysyntax_error_ (yyctx);
         error (]b4_join(b4_locations_if([yyla.location]), [[YY_MOVE (msg)]])[);]])[
       }
 
@@ -1184,7 +1522,8 @@ b4_dollar_popdef])[]dnl
   `-----------------------------------------------------*/
   yyreturn:
     if (!yyla.empty ())
-      yy_destroy_ ("Cleanup: discarding lookahead", yyla);
+      yy_destroy_ ("Cleanup: discarding lookahead", yyla);]b4_push_if([[
+    yyla.clear ();]])[
 
     /* Do not reclaim the symbols of the rule whose action triggered
        this YYABORT or YYACCEPT.  */
@@ -1194,8 +1533,10 @@ b4_dollar_popdef])[]dnl
       {
         yy_destroy_ ("Cleanup: popping", yystack_[0]);
         yypop_ ();
-      }
+      }]b4_push_if([[
+    yynew_ = true;
 
+  yypushreturn:]])[
     return yyresult;
   }
 #if YY_EXCEPTIONS
@@ -1205,13 +1546,15 @@ b4_dollar_popdef])[]dnl
         // Do not try to display the values of the reclaimed symbols,
         // as their printers might throw an exception.
         if (!yyla.empty ())
-          yy_destroy_ (YY_NULLPTR, yyla);
+          yy_destroy_ (YY_NULLPTR, yyla);]b4_push_if([[
+        yyla.clear ();]])[
 
         while (1 < yystack_.size ())
           {
             yy_destroy_ (YY_NULLPTR, yystack_[0]);
             yypop_ ();
-          }
+          }]b4_push_if([[
+        yynew_ = true;]])[
         throw;
       }
 #endif // YY_EXCEPTIONS
@@ -1219,10 +1562,17 @@ b4_dollar_popdef])[]dnl
 
   void
   ]b4_parser_class[::error (const syntax_error& yyexc)
-  {
+  {]b4_allocator_if([[
+    string_type yymsg (yyexc.what (), get_allocator ());]])[
     error (]b4_join(b4_locations_if([yyexc.location]),
-                    [[yyexc.what ()]])[);
-  }]b4_parse_error_bmatch([custom\|detailed\|verbose], [[
+                    b4_allocator_if([[[yymsg]]], [[[yyexc.what ()]]]))[);
+  }]b4_allocator_if([[
+
+  ]b4_parser_class[::allocator_type
+  ]b4_parser_class[::get_allocator () const
+  {
+    return allocator_type (yystack_.get_allocator ());
+  }]])[]b4_parse_error_bmatch([custom\|detailed\|verbose], [[
 
   // ]b4_parser_class[::context.
   ]b4_parser_class[::context::context (const ]b4_parser_class[& yyparser, const symbol_type& yyla)
@@ -1463,7 +1813,7 @@ b4_dollar_popdef])[]dnl
   }]])b4_parse_error_bmatch([detailed\|verbose], [[
 
   // Generate an error message.
-  std::string
+  ]b4_parser_class[::string_type
   ]b4_parser_class[::yysyntax_error_ (const context& yyctx) const
   {
     // Its maximum.
@@ -1489,7 +1839,7 @@ b4_dollar_popdef])[]dnl
 #undef YYCASE_
       }
 
-    std::string yyres;
+    string_type yyres]b4_allocator_if([ (get_allocator ())])[;
     // Argument number.
     std::ptrdiff_t yyi = 0;
     for (char const* yyp = yyformat; *yyp; ++yyp)
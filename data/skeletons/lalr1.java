@@ -17,6 +17,9 @@
 
 m4_include(b4_skeletonsdir/[java.m4])
 
+# Only the packed parser tables are supported.
+b4_percent_define_check_values([[[[api.table.encoding]], [[packed]]]])
+
 b4_defines_if([b4_complain([%defines does not make sense in Java])])
 
 m4_define([b4_symbol_no_destructor_assert],
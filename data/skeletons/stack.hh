@@ -26,20 +26,73 @@ b4_defines_if([b4_required_version_if([302], [],
 # b4_stack_define
 # ---------------
 m4_define([b4_stack_define],
-[[    /// A stack with random access from its top.
-    template <typename T, typename S = std::vector<T> >
+[[    /// Raw storage for the first N elements of a stack.
+    template <typename T, int N>
+    class stack_buffer
+    {
+    public:
+      T*
+      data () YY_NOEXCEPT
+      {
+        return static_cast<T*> (static_cast<void*> (yyraw_.yyraw));
+      }
+
+    private:
+      union
+      {
+        /// Strongest alignment constraints.
+        long double yyalign_me;
+        /// A buffer large enough to store N elements.
+        char yyraw[N * sizeof (T)];
+      } yyraw_;
+    };
+
+    /// No inline storage.
+    template <typename T>
+    class stack_buffer<T, 0>
+    {
+    public:
+      T*
+      data () YY_NOEXCEPT
+      {
+        return YY_NULLPTR;
+      }
+    };
+
+    /// A stack with random access from its top.
+    ///
+    /// The elements are constructed in place.  The first N ones are
+    /// stored in the stack itself, so shallow parses never allocate.
+    /// The storage is kept when elements are popped, so once the stack
+    /// reached its maximum depth, pushing does not allocate either.
+    /// Otherwise, the memory is obtained from A.
+    template <typename T, int N = 0, typename A = std::allocator<T> >
     class stack
     {
     public:
       // Hide our reversed order.
-      typedef typename S::iterator iterator;
-      typedef typename S::const_iterator const_iterator;
-      typedef typename S::size_type size_type;
+      typedef T* iterator;
+      typedef const T* const_iterator;
+      typedef std::size_t size_type;
       typedef typename std::ptrdiff_t index_type;
+      typedef A allocator_type;
+
+      /// Build an empty stack with room for \a n elements.
+      stack (size_type n = 200, const A& alloc = A ())
+        : alloc_ (alloc)
+        , size_ (0)
+        , capacity_ (N)
+      {
+        seq_ = buffer_.data ();
+        reserve (n);
+      }
 
-      stack (size_type n = 200)
-        : seq_ (n)
-      {}
+      ~stack ()
+      {
+        clear ();
+        if (seq_ != buffer_.data ())
+          alloc_.deallocate (seq_, capacity_);
+      }
 
       /// Random access.
       ///
@@ -47,7 +100,7 @@ m4_define([b4_stack_define],
       const T&
       operator[] (index_type i) const
       {
-        return seq_[size_type (size () - 1 - i)];
+        return seq_[size_ - 1 - size_type (i)];
       }
 
       /// Random access.
@@ -56,7 +109,7 @@ m4_define([b4_stack_define],
       T&
       operator[] (index_type i)
       {
-        return seq_[size_type (size () - 1 - i)];
+        return seq_[size_ - 1 - size_type (i)];
       }
 
       /// Steal the contents of \a t.
@@ -65,44 +118,111 @@ m4_define([b4_stack_define],
       void
       push (YY_MOVE_REF (T) t)
       {
-        seq_.push_back (T ());
-        operator[] (0).move (t);
+        if (size_ == capacity_)
+          reserve (2 * capacity_ + 1);
+#if 201103L <= YY_CPLUSPLUS
+        ::new (seq_ + size_) T (std::move (t));
+#else
+        (::new (seq_ + size_) T ())->move (t);
+#endif
+        ++size_;
+      }
+
+#if 201103L <= YY_CPLUSPLUS
+      /// Build a new top of the stack from \a args.
+      template <typename... U>
+      void
+      emplace (U&&... args)
+      {
+        if (size_ == capacity_)
+          reserve (2 * capacity_ + 1);
+        ::new (seq_ + size_) T (std::forward<U> (args)...);
+        ++size_;
       }
+#endif
 
       /// Pop elements from the stack.
       void
       pop (std::ptrdiff_t n = 1) YY_NOEXCEPT
       {
         for (; 0 < n; --n)
-          seq_.pop_back ();
+          seq_[--size_].~T ();
       }
 
       /// Pop all elements from the stack.
       void
       clear () YY_NOEXCEPT
       {
-        seq_.clear ();
+        pop (size ());
       }
 
       /// Number of elements on the stack.
       index_type
       size () const YY_NOEXCEPT
       {
-        return index_type (seq_.size ());
+        return index_type (size_);
+      }
+
+      /// Make room for at least \a n elements.
+      ///
+      /// If transferring an element throws, the stack keeps its storage
+      /// and its elements, and the exception is propagated.
+      void
+      reserve (size_type n)
+      {
+        if (capacity_ < n)
+          {
+            T* seq = alloc_.allocate (n);
+            size_type i = 0;
+#if YY_EXCEPTIONS
+            try
+#endif // YY_EXCEPTIONS
+              {
+                for (; i < size_; ++i)
+#if 201103L <= YY_CPLUSPLUS
+                  ::new (seq + i) T (std::move_if_noexcept (seq_[i]));
+#else
+                  (::new (seq + i) T ())->move (seq_[i]);
+#endif
+              }
+#if YY_EXCEPTIONS
+            catch (...)
+              {
+                while (i)
+                  seq[--i].~T ();
+                alloc_.deallocate (seq, n);
+                throw;
+              }
+#endif // YY_EXCEPTIONS
+            // Release the old elements only once they are all in SEQ.
+            for (i = 0; i < size_; ++i)
+              seq_[i].~T ();
+            if (seq_ != buffer_.data ())
+              alloc_.deallocate (seq_, capacity_);
+            seq_ = seq;
+            capacity_ = n;
+          }
+      }
+
+      /// The allocator of the elements.
+      allocator_type
+      get_allocator () const YY_NOEXCEPT
+      {
+        return alloc_;
       }
 
       /// Iterator on top of the stack (going downwards).
       const_iterator
       begin () const YY_NOEXCEPT
       {
-        return seq_.begin ();
+        return seq_;
       }
 
       /// Bottom of the stack.
       const_iterator
       end () const YY_NOEXCEPT
       {
-        return seq_.end ();
+        return seq_ + size_;
       }
 
       /// Present a slice of the top of a stack.
@@ -128,8 +248,16 @@ m4_define([b4_stack_define],
     private:
       stack (const stack&);
       stack& operator= (const stack&);
-      /// The wrapped container.
-      S seq_;
+      /// The allocator of the elements.
+      A alloc_;
+      /// The storage of the first N elements.
+      stack_buffer<T, N> buffer_;
+      /// The elements, from the bottom.
+      T* seq_;
+      /// Number of elements.
+      size_type size_;
+      /// Number of elements seq_ can hold.
+      size_type capacity_;
     };
 ]])
 
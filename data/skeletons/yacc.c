@@ -1741,14 +1741,18 @@ yyread_pushed_token:]])[
 
   /* If the proper action on seeing token YYTOKEN is to reduce or to
      detect an error, take that action.  */
-  yyn += yytoken;
-  if (yyn < 0 || YYLAST < yyn || yycheck[yyn] != yytoken)]b4_lac_if([[
+]b4_table_encoding_case([[  yyn += yytoken;
+  if (yyn < 0 || YYLAST < yyn || yycheck[yyn] != yytoken)]],
+[[  yyn = yyaction[yystate * YYNTOKENS + yytoken];
+  if (yyn == 0)]],
+[[  yyn = yyaction[yyactrow[yystate] * YYNTOKENS + yytoken];
+  if (yyn == 0)]])[]b4_lac_if([[
     {
       YY_LAC_ESTABLISH;
       goto yydefault;
     }]], [[
-    goto yydefault;]])[
-  yyn = yytable[yyn];
+    goto yydefault;]])[]b4_table_encoding_case([[
+  yyn = yytable[yyn];]])[
   if (yyn <= 0)
     {
       if (yytable_value_is_error (yyn))
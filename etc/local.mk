@@ -14,4 +14,19 @@
 ## You should have received a copy of the GNU General Public License
 ## along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-nodist_noinst_SCRIPTS = etc/bench.pl
+nodist_noinst_SCRIPTS = etc/bench.pl etc/bench-generator.pl \
+  etc/bench-runtime.pl
+
+# Bench Bison itself.  Pass options to etc/bench-generator.pl with
+# BENCH_GENERATOR_FLAGS, e.g., BENCH_GENERATOR_FLAGS='-l ielr -s 2'.
+.PHONY: bench-generator
+bench-generator: etc/bench-generator.pl src/bison$(EXEEXT)
+	$(AM_V_at)etc/bench-generator.pl $(BENCH_GENERATOR_FLAGS)
+
+# Bench the generated parsers.  Pass options to etc/bench-runtime.pl
+# with BENCH_RUNTIME_FLAGS, e.g., BENCH_RUNTIME_FLAGS='-s yacc.c -a'.
+.PHONY: bench-runtime
+bench-runtime: etc/bench-runtime.pl src/bison$(EXEEXT)
+	$(AM_V_at)CC='$(CC)' CXX='$(CXX)' DC='$(DC)'			\
+	  JAVAC='$(CONF_JAVAC)' JAVA='$(CONF_JAVA)'			\
+	  etc/bench-runtime.pl $(BENCH_RUNTIME_FLAGS)
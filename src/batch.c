@@ -0,0 +1,232 @@
+/* Running several jobs in a single invocation of Bison.
+
+   Copyright (C) 2020 Free Software Foundation, Inc.
+
+   This file is part of Bison, the GNU Compiler Compiler.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <config.h>
+
+#include "batch.h"
+
+#include "system.h"
+
+#include <c-ctype.h>
+#include <error.h>
+#include <get-errno.h>
+#include <getopt.h>
+#include <progname.h>
+#include <sys/wait.h>
+
+#include "files.h"
+#include "getargs.h"
+
+/* Bison keeps most of its state in global variables, and exits on
+   fatal errors.  So each job is run in a child process forked once
+   the startup of Bison is done (locale, options common to all the
+   jobs, etc.): the jobs start from the same state as a separate run of
+   Bison, without paying for its startup.  */
+
+/* A running job.  */
+typedef struct
+{
+  pid_t pid;
+  /* The line of the job in the input.  */
+  int line;
+} batch_job;
+
+
+/*-------------------------------------------------------------------.
+| Split LINE in place into words separated by blanks, honoring       |
+| single quotes, double quotes and backslashes as the shell does.    |
+| Store them in *ARGVP, after the program name, and return their     |
+| number (including the program name), or -1 on unterminated quotes. |
+`-------------------------------------------------------------------*/
+
+static int
+batch_split (char *line, char ***argvp)
+{
+  size_t argv_alloc = 8;
+  char **argv = xnmalloc (argv_alloc, sizeof *argv);
+  int argc = 0;
+  argv[argc++] = (char *) program_name;
+
+  char *in = line;
+  while (true)
+    {
+      while (c_isspace (*in))
+        ++in;
+      if (!*in)
+        break;
+
+      /* Unquoting never makes a word longer: write it over itself.  */
+      char *word = in;
+      char *out = in;
+      char quote = 0;
+      for (; *in && (quote || !c_isspace (*in)); ++in)
+        if (quote && *in == quote)
+          quote = 0;
+        else if (!quote && (*in == '\'' || *in == '"'))
+          quote = *in;
+        else if (*in == '\\' && quote != '\''
+                 && (!quote || in[1] == '"' || in[1] == '\\')
+                 && in[1])
+          *out++ = *++in;
+        else
+          *out++ = *in;
+      if (quote)
+        {
+          free (argv);
+          return -1;
+        }
+      if (*in)
+        ++in;
+      *out = '\0';
+
+      if (argv_alloc <= (size_t) argc + 1)
+        argv = x2nrealloc (argv, &argv_alloc, sizeof *argv);
+      argv[argc++] = word;
+    }
+  argv[argc] = NULL;
+  *argvp = argv;
+  return argc;
+}
+
+
+#if HAVE_WORKING_FORK
+
+/* Report that the job at LINE completed with STATUS.  */
+static void
+batch_report (int line, int status)
+{
+  if (server_flag)
+    {
+      printf ("%d %d\n", line, status);
+      fflush (stdout);
+    }
+}
+
+/* Start the job ARGV read from IN.  */
+static pid_t
+batch_spawn (batch_job_fn run, FILE *in, int argc, char *argv[])
+{
+  /* Do not output twice what is pending in the buffers.  */
+  fflush (stdout);
+  fflush (stderr);
+  pid_t res = fork ();
+  if (res < 0)
+    error (EXIT_FAILURE, get_errno (), _("cannot fork"));
+  if (res == 0)
+    {
+      /* The parent keeps on reading IN: exit must not flush it.  */
+      close (fileno (in));
+      /* Restart the options parsing from scratch.  */
+      optind = 0;
+      exit (run (argc, argv));
+    }
+  return res;
+}
+
+/* Wait for the completion of one of the NRUNNING jobs of RUNNING,
+   report it, and remove it from RUNNING.  Return whether it
+   succeeded.  */
+static bool
+batch_wait (batch_job *running, int *nrunning)
+{
+  int status;
+  pid_t pid;
+  while ((pid = waitpid (-1, &status, 0)) < 0)
+    if (get_errno () != EINTR)
+      error (EXIT_FAILURE, get_errno (), _("cannot wait for jobs"));
+  int exit_status = (WIFEXITED (status) ? WEXITSTATUS (status)
+                     : WIFSIGNALED (status) ? 128 + WTERMSIG (status)
+                     : EXIT_FAILURE);
+  for (int i = 0; i < *nrunning; ++i)
+    if (running[i].pid == pid)
+      {
+        batch_report (running[i].line, exit_status);
+        running[i] = running[--*nrunning];
+        break;
+      }
+  return exit_status == EXIT_SUCCESS;
+}
+
+int
+batch_run (batch_job_fn run)
+{
+  char const *in_name = server_flag ? "-" : batch_file;
+  FILE *in = STREQ (in_name, "-") ? stdin : xfopen (in_name, "r");
+
+  batch_job *running = xnmalloc (jobs, sizeof *running);
+  int nrunning = 0;
+  bool ok = true;
+
+  char *line = NULL;
+  size_t line_size = 0;
+  for (int lineno = 1; getline (&line, &line_size, in) != -1; ++lineno)
+    {
+      /* Skip comments.  */
+      char const *cp = line;
+      while (c_isspace (*cp))
+        ++cp;
+      if (*cp == '#')
+        continue;
+
+      char **argv;
+      int argc = batch_split (line, &argv);
+      if (argc < 0)
+        {
+          error (0, 0, "%s:%d: %s", in_name, lineno,
+                 _("unterminated quoted string"));
+          batch_report (lineno, EXIT_FAILURE);
+          ok = false;
+          continue;
+        }
+      /* Skip empty lines.  */
+      if (argc == 1)
+        {
+          free (argv);
+          continue;
+        }
+      if (nrunning == jobs)
+        ok &= batch_wait (running, &nrunning);
+      running[nrunning].pid = batch_spawn (run, in, argc, argv);
+      running[nrunning].line = lineno;
+      ++nrunning;
+      free (argv);
+    }
+  while (nrunning)
+    ok &= batch_wait (running, &nrunning);
+
+  free (line);
+  free (running);
+  if (in != stdin)
+    xfclose (in);
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#else /* !HAVE_WORKING_FORK */
+
+int
+batch_run (batch_job_fn run)
+{
+  (void) run;
+  (void) batch_split;
+  error (EXIT_FAILURE, 0, _("%s is not supported on this platform"),
+         server_flag ? "--server" : "--batch");
+  return EXIT_FAILURE;
+}
+
+#endif /* !HAVE_WORKING_FORK */
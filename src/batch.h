@@ -0,0 +1,34 @@
+/* Running several jobs in a single invocation of Bison.
+
+   Copyright (C) 2020 Free Software Foundation, Inc.
+
+   This file is part of Bison, the GNU Compiler Compiler.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifndef BATCH_H_
+# define BATCH_H_
+
+/* A job: process the command line ARGV (ARGV[0] being the program
+   name), and return the exit status.  */
+typedef int (*batch_job_fn) (int argc, char *argv[]);
+
+/* Read the jobs from BATCH_FILE (or the standard input for --server),
+   one command line per line, and run each of them with RUN, up to
+   JOBS at a time.  With --server, report the status of each job on
+   the standard output as soon as it completes.  Return the exit
+   status: failure if any job failed.  */
+int batch_run (batch_job_fn run);
+
+#endif /* !BATCH_H_ */
@@ -0,0 +1,296 @@
+/* Cache of the automaton tables, for Bison.
+
+   Copyright (C) 2020 Free Software Foundation, Inc.
+
+   This file is part of Bison, the GNU Compiler Compiler.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <config.h>
+#include "system.h"
+
+#include <errno.h>
+#include <get-errno.h>
+#include <intprops.h>
+#include <path-join.h>
+#include <quote.h>
+#include <sha256.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+#include "complain.h"
+#include "conflicts.h"
+#include "getargs.h"
+#include "gram.h"
+#include "muscle-tab.h"
+#include "reduce.h"
+#include "state.h"
+#include "symtab.h"
+#include "tables.h"
+
+/* Change whenever the layout of the cache files changes.  */
+enum { cache_format = 1 };
+
+/* The beginning of the cache files.  */
+static char const cache_magic[] = "GNU Bison tables cache " VERSION "\n";
+
+/* The %define variables that the tables depend upon.  */
+static char const *const cache_variables[] =
+{
+  "api.table.encoding",
+  "lr.default-reduction",
+  "lr.keep-unreachable-state",
+  "lr.type",
+  NULL
+};
+
+
+/*-------------------------------------------------------------------.
+| Compute in KEY a hash of all that the tables, and the diagnostics  |
+| issued while computing them, depend upon.                          |
+`-------------------------------------------------------------------*/
+
+static void
+cache_key_int (struct sha256_ctx *ctx, int i)
+{
+  sha256_process_bytes (&i, sizeof i, ctx);
+}
+
+static void
+cache_key_string (struct sha256_ctx *ctx, char const *s)
+{
+  sha256_process_bytes (s, strlen (s) + 1, ctx);
+}
+
+static void
+cache_key (unsigned char key[SHA256_DIGEST_SIZE])
+{
+  struct sha256_ctx ctx;
+  sha256_init_ctx (&ctx);
+  cache_key_string (&ctx, cache_magic);
+  cache_key_int (&ctx, cache_format);
+
+  /* The reduced grammar.  */
+  cache_key_int (&ctx, ntokens);
+  cache_key_int (&ctx, nvars);
+  cache_key_int (&ctx, nrules);
+  for (symbol_number i = 0; i < nsyms; ++i)
+    {
+      cache_key_int (&ctx, symbols[i]->content->prec);
+      cache_key_int (&ctx, symbols[i]->content->assoc);
+    }
+  for (rule_number r = 0; r < nrules; ++r)
+    {
+      cache_key_int (&ctx, rules[r].lhs->number);
+      for (item_number *rhsp = rules[r].rhs; 0 <= *rhsp; ++rhsp)
+        cache_key_int (&ctx, *rhsp);
+      cache_key_int (&ctx, -1);
+      cache_key_int (&ctx, rules[r].prec ? rules[r].prec->prec : 0);
+      cache_key_int (&ctx, rules[r].prec ? rules[r].prec->assoc : 0);
+      cache_key_int (&ctx, rules[r].expected_sr_conflicts);
+      cache_key_int (&ctx, rules[r].expected_rr_conflicts);
+    }
+
+  /* The options.  */
+  cache_key_int (&ctx, expected_sr_conflicts);
+  cache_key_int (&ctx, expected_rr_conflicts);
+  cache_key_int (&ctx, glr_parser);
+  cache_key_int (&ctx, nondeterministic_parser);
+  for (int i = 0; cache_variables[i]; ++i)
+    {
+      char *value = muscle_percent_define_get (cache_variables[i]);
+      cache_key_string (&ctx, value);
+      free (value);
+    }
+  for (int i = 0; i < warnings_size; ++i)
+    cache_key_int (&ctx, warning_is_enabled (1 << i));
+
+  sha256_finish_ctx (&ctx, key);
+}
+
+/* The name of the cache file for KEY.  */
+static char *
+cache_file_name (unsigned char const key[SHA256_DIGEST_SIZE])
+{
+  char hex[2 * SHA256_DIGEST_SIZE + 1];
+  for (int i = 0; i < SHA256_DIGEST_SIZE; ++i)
+    sprintf (hex + 2 * i, "%02x", key[i]);
+  return xpath_join (cache_dir, hex);
+}
+
+
+/*---------------------------------------------------------------.
+| The layout of the cache files: CACHE_MAGIC, CACHE_FORMAT, the  |
+| key, the scalars of CACHE_SCALARS, and the arrays of           |
+| CACHE_ARRAYS.  Native byte order: the cache is not meant to be |
+| shared between machines.                                       |
+`---------------------------------------------------------------*/
+
+static int *const cache_scalars[] =
+{
+  &nstates, &yyfinal, &high, &base_ninf, &table_ninf,
+  &conflict_list_cnt, &nactrows,
+};
+
+typedef struct
+{
+  int **data;
+  int size;
+} cache_array;
+
+/* Store the arrays of the tables in ARRAYS, and return their number.
+   Depends on the scalars.  */
+static int
+cache_arrays (cache_array *arrays)
+{
+  int res = 0;
+  arrays[res++] = (cache_array) { &yystos, nstates };
+  arrays[res++] = (cache_array) { &yydefact, nstates };
+  arrays[res++] = (cache_array) { &yydefgoto, nvars };
+  arrays[res++] = (cache_array) { &base, nstates + nvars };
+  arrays[res++] = (cache_array) { &table, high + 1 };
+  arrays[res++] = (cache_array) { &check, high + 1 };
+  arrays[res++] = (cache_array) { &conflict_table, high + 1 };
+  arrays[res++] = (cache_array) { &conflict_list, conflict_list_cnt };
+  if (tables_encoding != table_encoding_packed)
+    {
+      int nrows = (tables_encoding == table_encoding_dense
+                   ? nstates : nactrows);
+      arrays[res++] = (cache_array) { &yyaction, nrows * ntokens };
+    }
+  if (tables_encoding == table_encoding_two_level)
+    arrays[res++] = (cache_array) { &yyactrow, nstates };
+  return res;
+}
+
+enum { cache_arrays_max = 10 };
+
+/* Whether the next SIZE bytes of IN are DATA.  */
+static bool
+cache_read_check (FILE *in, void const *data, size_t size)
+{
+  char buf[128];
+  aver (size <= sizeof buf);
+  return fread (buf, 1, size, in) == size && memcmp (buf, data, size) == 0;
+}
+
+bool
+cache_load (void)
+{
+  /* The reports need the automaton.  */
+  if (!cache_dir || report_flag || graph_flag || xml_flag)
+    return false;
+
+  unsigned char key[SHA256_DIGEST_SIZE];
+  cache_key (key);
+  char *name = cache_file_name (key);
+  FILE *in = fopen (name, "rb");
+  free (name);
+  if (!in)
+    return false;
+
+  int format = cache_format;
+  int scalars[ARRAY_CARDINALITY (cache_scalars)];
+  bool res = (cache_read_check (in, cache_magic, sizeof cache_magic)
+              && cache_read_check (in, &format, sizeof format)
+              && cache_read_check (in, key, sizeof key)
+              && (fread (scalars, sizeof *scalars, ARRAY_CARDINALITY (scalars),
+                         in)
+                  == ARRAY_CARDINALITY (scalars)));
+  for (size_t i = 0; res && i < ARRAY_CARDINALITY (scalars); ++i)
+    res = 0 <= scalars[i];
+  cache_array arrays[cache_arrays_max];
+  int nloaded = 0;
+  if (res)
+    {
+      for (size_t i = 0; i < ARRAY_CARDINALITY (scalars); ++i)
+        *cache_scalars[i] = scalars[i];
+      nvectors = nstates + nvars;
+      tables_encoding_init ();
+      int narrays = cache_arrays (arrays);
+      for (; res && nloaded < narrays; ++nloaded)
+        {
+          cache_array *a = &arrays[nloaded];
+          size_t size = a->size;
+          *a->data = xnmalloc (size + 1, sizeof **a->data);
+          res = fread (*a->data, sizeof **a->data, size, in) == size;
+        }
+      res = res && getc (in) == EOF;
+    }
+  fclose (in);
+
+  /* A truncated or corrupted file: compute the tables.  */
+  if (!res)
+    {
+      for (int i = 0; i < nloaded; ++i)
+        {
+          free (*arrays[i].data);
+          *arrays[i].data = NULL;
+        }
+      nstates = 0;
+    }
+  return res;
+}
+
+/* Write the tables of KEY into OUT.  Return whether there were no
+   errors.  */
+static bool
+cache_write (FILE *out, unsigned char const key[SHA256_DIGEST_SIZE])
+{
+  int format = cache_format;
+  fwrite (cache_magic, 1, sizeof cache_magic, out);
+  fwrite (&format, sizeof format, 1, out);
+  fwrite (key, 1, SHA256_DIGEST_SIZE, out);
+  for (size_t i = 0; i < ARRAY_CARDINALITY (cache_scalars); ++i)
+    fwrite (cache_scalars[i], sizeof *cache_scalars[i], 1, out);
+  cache_array arrays[cache_arrays_max];
+  int narrays = cache_arrays (arrays);
+  for (int i = 0; i < narrays; ++i)
+    fwrite (*arrays[i].data, sizeof **arrays[i].data, arrays[i].size, out);
+  bool res = !ferror (out);
+  return fclose (out) == 0 && res;
+}
+
+void
+cache_save (void)
+{
+  if (!cache_dir)
+    return;
+
+  if (mkdir (cache_dir, 0777) != 0 && get_errno () != EEXIST)
+    {
+      complain (NULL, Wother, _("cannot create cache directory %s: %s"),
+                quote (cache_dir), strerror (get_errno ()));
+      return;
+    }
+
+  unsigned char key[SHA256_DIGEST_SIZE];
+  cache_key (key);
+  char *name = cache_file_name (key);
+  /* Write to a temporary file which is then renamed, so that
+     concurrent runs never see a partial file.  */
+  char *tmp = xmalloc (strlen (name) + sizeof ".tmp"
+                       + INT_BUFSIZE_BOUND (long));
+  sprintf (tmp, "%s.tmp%ld", name, (long) getpid ());
+
+  FILE *out = fopen (tmp, "wb");
+  if (!out || !cache_write (out, key) || rename (tmp, name) != 0)
+    {
+      complain (NULL, Wother, _("cannot write cache file %s: %s"),
+                quote (name), strerror (get_errno ()));
+      unlink (tmp);
+    }
+  free (tmp);
+  free (name);
+}
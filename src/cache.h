@@ -0,0 +1,41 @@
+/* Cache of the automaton tables, for Bison.
+
+   Copyright (C) 2020 Free Software Foundation, Inc.
+
+   This file is part of Bison, the GNU Compiler Compiler.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifndef CACHE_H_
+# define CACHE_H_
+
+/* With --cache-dir, the parser tables are saved in a file named after
+   a hash of all they depend upon: the structure of the reduced grammar
+   (symbols, rules, precedence), the %define lr.* variables, etc., but
+   not the actions, %code blocks or epilogue.  A later run on a grammar
+   with the same structure loads them instead of building the
+   automaton.  */
+
+/* Load the tables of the current grammar (see tables.h) from the
+   cache.  Return whether they were found.  The automaton itself is
+   not available, so the cache is not used when it is needed (e.g.,
+   for the reports).  */
+bool cache_load (void);
+
+/* Save the tables of the current grammar in the cache.  Must be called
+   only if no diagnostics were issued while computing them, since they
+   will not be issued when loading them.  */
+void cache_save (void);
+
+#endif /* !CACHE_H_ */
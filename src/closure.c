@@ -23,6 +23,8 @@
 
 #include <bitset.h>
 #include <bitsetv.h>
+#include <glthread/lock.h>
+#include <hash.h>
 
 #include "closure.h"
 #include "derives.h"
@@ -35,11 +37,6 @@
 item_number *itemset;
 size_t nitemset;
 
-/* RULESET contains a bit for each rule.  CLOSURE sets the bits for
-   all rules which could potentially describe the next input to be
-   read.  */
-static bitset ruleset;
-
 /* internal data.  See comments before set_fderives and set_firsts.  */
 static bitsetv fderives = NULL;
 static bitsetv firsts = NULL;
@@ -169,67 +166,280 @@ set_fderives (void)
 
 
 
-void
-closure_new (int n)
+                        /*----------------.
+                        | Closure cache.  |
+                        `----------------*/
+
+/* The items that closure adds to a core depend only on the set of
+   nonterminals after the dot in this core, and in practice, many
+   states share the same set.  Therefore, the cache maps such sets of
+   nonterminals to the (sorted) items that begin the rules they
+   derive.
+
+   The cache is shared by all the closure contexts, and protected by a
+   lock since generate_states may use several threads.  Its entries
+   live as long as FDERIVES, so that the reports (print.c etc.), which
+   compute the closures again, benefit from it.  */
+
+typedef struct
+{
+  /* The nonterminals after the dot: sorted, without duplicates.  */
+  symbol_number *nterms;
+  size_t nnterms;
+  /* The items that begin the rules they derive, sorted.  */
+  item_number *items;
+  size_t nitems;
+} closure_cache_entry;
+
+/* Initial capacity of the closure cache.  */
+#define CLOSURE_CACHE_INITIAL_CAPACITY 257
+
+static struct hash_table *closure_cache = NULL;
+/* Storage for the entries of CLOSURE_CACHE.  */
+static struct obstack closure_cache_obstack;
+gl_rwlock_define_initialized (static, closure_cache_lock)
+
+/* Statistics.  */
+static size_t closure_cache_hits = 0;
+static size_t closure_cache_misses = 0;
+
+static bool
+closure_cache_comparator (void const *e1, void const *e2)
 {
-  itemset = xnmalloc (n, sizeof *itemset);
+  closure_cache_entry const *c1 = e1;
+  closure_cache_entry const *c2 = e2;
+  return (c1->nnterms == c2->nnterms
+          && !memcmp (c1->nterms, c2->nterms,
+                      c1->nnterms * sizeof *c1->nterms));
+}
 
-  ruleset = bitset_create (nrules, BITSET_FIXED);
+static size_t
+closure_cache_hasher (void const *e, size_t tablesize)
+{
+  closure_cache_entry const *c = e;
+  size_t key = c->nnterms;
+  for (size_t i = 0; i < c->nnterms; ++i)
+    key = key * 31 + c->nterms[i];
+  return key % tablesize;
+}
 
-  set_fderives ();
+static void
+closure_cache_new (void)
+{
+  closure_cache = hash_xinitialize (CLOSURE_CACHE_INITIAL_CAPACITY,
+                                    NULL,
+                                    closure_cache_hasher,
+                                    closure_cache_comparator,
+                                    NULL);
+  obstack_init (&closure_cache_obstack);
+  closure_cache_hits = 0;
+  closure_cache_misses = 0;
 }
 
+static void
+closure_cache_free (void)
+{
+  if (!closure_cache)
+    return;
+  if (trace_flag & (trace_closure | trace_time))
+    fprintf (stderr,
+             "closure cache: %zu hits, %zu misses, %zu entries\n",
+             closure_cache_hits, closure_cache_misses,
+             hash_get_n_entries (closure_cache));
+  hash_free (closure_cache);
+  closure_cache = NULL;
+  obstack_free (&closure_cache_obstack, NULL);
+}
 
 
-void
-closure (item_number const *core, size_t n)
+static int
+symbol_number_cmp (void const *a, void const *b)
 {
-  if (trace_flag & trace_closure)
-    closure_print ("input", core, n);
+  symbol_number const *l = a;
+  symbol_number const *r = b;
+  return *l - *r;
+}
 
-  bitset_zero (ruleset);
 
+/*------------------------------------------------------------------.
+| Return the cache entry for the nonterminals after the dot in the  |
+| N items of CORE.  On a miss, compute the entry, using CTX as      |
+| scratch space.                                                    |
+`------------------------------------------------------------------*/
+
+static closure_cache_entry const *
+closure_cache_fetch (closure_context *ctx, item_number const *core, size_t n)
+{
+  /* The key: the sorted set of nonterminals after the dot.  */
+  closure_cache_entry probe;
+  probe.nterms = ctx->nterms;
+  probe.nnterms = 0;
   for (size_t c = 0; c < n; ++c)
     if (ISVAR (ritem[core[c]]))
-      bitset_or (ruleset, ruleset, FDERIVES (ritem[core[c]]));
+      probe.nterms[probe.nnterms++] = ritem[core[c]];
+  qsort (probe.nterms, probe.nnterms, sizeof *probe.nterms,
+         symbol_number_cmp);
+  {
+    size_t j = 0;
+    for (size_t i = 0; i < probe.nnterms; ++i)
+      if (!j || probe.nterms[j - 1] != probe.nterms[i])
+        probe.nterms[j++] = probe.nterms[i];
+    probe.nnterms = j;
+  }
+
+  gl_rwlock_rdlock (closure_cache_lock);
+  closure_cache_entry const *res = hash_lookup (closure_cache, &probe);
+  gl_rwlock_unlock (closure_cache_lock);
+  if (res)
+    {
+      ++ctx->hits;
+      return res;
+    }
+
+  /* Miss: compute the items of the rules derived by these
+     nonterminals.  */
+  ++ctx->misses;
+  bitset_zero (ctx->ruleset);
+  for (size_t i = 0; i < probe.nnterms; ++i)
+    bitset_or (ctx->ruleset, ctx->ruleset, FDERIVES (probe.nterms[i]));
+
+  gl_rwlock_wrlock (closure_cache_lock);
+  /* Another thread might have inserted it meanwhile.  */
+  res = hash_lookup (closure_cache, &probe);
+  if (!res)
+    {
+      closure_cache_entry *e
+        = obstack_alloc (&closure_cache_obstack, sizeof *e);
+      e->nnterms = probe.nnterms;
+      e->nterms = obstack_copy (&closure_cache_obstack, probe.nterms,
+                                probe.nnterms * sizeof *probe.nterms);
+      e->nitems = bitset_count (ctx->ruleset);
+      e->items = obstack_alloc (&closure_cache_obstack,
+                                e->nitems * sizeof *e->items);
+      size_t i = 0;
+      rule_number ruleno;
+      bitset_iterator iter;
+      BITSET_FOR_EACH (iter, ctx->ruleset, ruleno, 0)
+        e->items[i++] = rules[ruleno].rhs - ritem;
+      res = hash_xinsert (closure_cache, e);
+    }
+  gl_rwlock_unlock (closure_cache_lock);
+  return res;
+}
+
+
+                        /*-------------------.
+                        | Closure contexts.  |
+                        `-------------------*/
+
+/* The context used by closure.  */
+static closure_context *closure_ctx = NULL;
+
+closure_context *
+closure_context_new (void)
+{
+  closure_context *res = xmalloc (sizeof *res);
+  res->itemset = xnmalloc (nritems, sizeof *res->itemset);
+  res->nitemset = 0;
+  res->ruleset = bitset_create (nrules, BITSET_FIXED);
+  res->nterms = xnmalloc (nritems, sizeof *res->nterms);
+  res->hits = 0;
+  res->misses = 0;
+  return res;
+}
+
+
+void
+closure_context_compute (closure_context *ctx,
+                         item_number const *core, size_t n)
+{
+  if (trace_flag & trace_closure)
+    closure_print ("input", core, n);
+
+  closure_cache_entry const *e = closure_cache_fetch (ctx, core, n);
 
   /* core is sorted on item index in ritem, which is sorted on rule number.
      Compute itemset with the same sort.  */
-  nitemset = 0;
+  item_number *res = ctx->itemset;
+  size_t nres = 0;
   size_t c = 0;
-
-  /* A bit index over RULESET. */
-  rule_number ruleno;
-  bitset_iterator iter;
-  BITSET_FOR_EACH (iter, ruleset, ruleno, 0)
+  for (size_t i = 0; i < e->nitems; ++i)
     {
-      item_number itemno = rules[ruleno].rhs - ritem;
+      item_number itemno = e->items[i];
       while (c < n && core[c] < itemno)
         {
-          itemset[nitemset] = core[c];
-          nitemset++;
+          res[nres] = core[c];
+          nres++;
           c++;
         }
-      itemset[nitemset] = itemno;
-      nitemset++;
-    };
+      res[nres] = itemno;
+      nres++;
+    }
 
   while (c < n)
     {
-      itemset[nitemset] = core[c];
-      nitemset++;
+      res[nres] = core[c];
+      nres++;
       c++;
     }
 
+  ctx->nitemset = nres;
+
   if (trace_flag & trace_closure)
-    closure_print ("output", itemset, nitemset);
+    closure_print ("output", res, nres);
+}
+
+
+void
+closure_context_free (closure_context *ctx)
+{
+  if (ctx)
+    {
+      gl_rwlock_wrlock (closure_cache_lock);
+      closure_cache_hits += ctx->hits;
+      closure_cache_misses += ctx->misses;
+      gl_rwlock_unlock (closure_cache_lock);
+      free (ctx->itemset);
+      bitset_free (ctx->ruleset);
+      free (ctx->nterms);
+      free (ctx);
+    }
+}
+
+
+                        /*----------.
+                        | Closure.  |
+                        `----------*/
+
+void
+closure_new (int n)
+{
+  set_fderives ();
+  closure_cache_new ();
+
+  closure_ctx = closure_context_new ();
+  /* The context uses NRITEMS items, which is what all our callers
+     pass.  */
+  aver (n <= nritems);
+  itemset = closure_ctx->itemset;
+}
+
+
+void
+closure (item_number const *core, size_t n)
+{
+  closure_context_compute (closure_ctx, core, n);
+  nitemset = closure_ctx->nitemset;
 }
 
 
 void
 closure_free (void)
 {
-  free (itemset);
-  bitset_free (ruleset);
+  closure_context_free (closure_ctx);
+  closure_ctx = NULL;
+  itemset = NULL;
+  nitemset = 0;
+  closure_cache_free ();
   bitsetv_free (fderives);
 }
@@ -21,11 +21,13 @@
 #ifndef CLOSURE_H_
 # define CLOSURE_H_
 
+# include <bitset.h>
+
 # include "gram.h"
 
 /* Allocates the itemset and ruleset vectors, and precomputes useful
    data so that closure can be called.  n is the number of elements to
-   allocate for itemset.  */
+   allocate for itemset, at most NRITEMS.  */
 
 void closure_new (int n);
 
@@ -38,7 +40,8 @@ void closure_new (int n);
 void closure (item_number const *items, size_t n);
 
 
-/* Free ITEMSET, RULESET and internal data.  */
+/* Free ITEMSET, RULESET and internal data.  Report the closure cache
+   statistics with --trace=closure or --trace=time.  */
 
 void closure_free (void);
 
@@ -51,4 +54,32 @@ void closure_free (void);
 extern item_number *itemset;
 extern size_t nitemset;
 
+
+/* Private storage for the computation of closures, for callers that
+   compute several closures concurrently (see generate_states).  Must
+   be created after closure_new, and freed before closure_free.  */
+
+typedef struct
+{
+  /* Same as the global ITEMSET and NITEMSET.  */
+  item_number *itemset;
+  size_t nitemset;
+  /* Contains a bit for each rule.  Used to compute the rules which
+     could potentially describe the next input to be read.  */
+  bitset ruleset;
+  /* Scratch space for the nonterminals after the dot.  */
+  symbol_number *nterms;
+  /* Statistics about the closure cache.  */
+  size_t hits;
+  size_t misses;
+} closure_context;
+
+closure_context *closure_context_new (void);
+
+/* Same as closure, but store the result in CTX.  */
+void closure_context_compute (closure_context *ctx,
+                              item_number const *items, size_t n);
+
+void closure_context_free (closure_context *ctx);
+
 #endif /* !CLOSURE_H_ */
@@ -37,6 +37,8 @@
 
 err_status complaint_status = status_none;
 
+int diagnostics_count = 0;
+
 bool warnings_are_errors = false;
 
 /** Whether -Werror/-Wno-error was applied to a warning.  */
@@ -485,6 +487,7 @@ complains (const location *loc, warnings flags,
     {
       if (severity_error <= s && ! complaint_status)
         complaint_status = status_warning_as_error;
+      ++diagnostics_count;
       error_message (loc, flags, s, message, args);
     }
 
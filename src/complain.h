@@ -177,4 +177,7 @@ typedef enum
 /** Whether an error was reported.  */
 extern err_status complaint_status;
 
+/** The number of diagnostics issued so far.  */
+extern int diagnostics_count;
+
 #endif /* !COMPLAIN_H_ */
@@ -31,6 +31,7 @@
 #include "lalr.h"
 #include "lr0.h"
 #include "print-xml.h"
+#include "profile.h"
 #include "reader.h"
 #include "state.h"
 #include "symtab.h"
@@ -400,8 +401,8 @@ conflicts_solve (void)
   symbol **errors = xnmalloc (ntokens + 1, sizeof *errors);
 
   conflicts = xcalloc (nstates, sizeof *conflicts);
-  shift_set = bitset_create (ntokens, BITSET_FIXED);
-  lookahead_set = bitset_create (ntokens, BITSET_FIXED);
+  shift_set = bitset_create (ntokens, lookahead_attrs);
+  lookahead_set = bitset_create (ntokens, lookahead_attrs);
   obstack_init (&solved_conflicts_obstack);
   obstack_init (&solved_conflicts_xml_obstack);
 
@@ -560,7 +561,7 @@ count_rule_state_rr_conflicts (rule *r, state *s)
 {
   size_t res = 0;
   const reductions *reds = s->reductions;
-  bitset lookaheads = bitset_create (ntokens, BITSET_FIXED);
+  bitset lookaheads = bitset_create (ntokens, lookahead_attrs);
 
   for (int i = 0; i < reds->num; ++i)
     if (reds->rules[i] == r)
@@ -674,6 +675,7 @@ conflicts_print (void)
      different strings to translate.  */
   {
     int total = count_sr_conflicts ();
+    profile_count ("sr_conflicts", total);
     /* If %expect is not used, but %expect-rr is, then expect 0 sr.  */
     int expected =
       (expected_sr_conflicts == -1 && expected_rr_conflicts != -1)
@@ -696,6 +698,7 @@ conflicts_print (void)
 
   {
     int total = count_rr_conflicts ();
+    profile_count ("rr_conflicts", total);
     /* If %expect-rr is not used, but %expect is, then expect 0 rr.  */
     int expected =
       (expected_rr_conflicts == -1 && expected_sr_conflicts != -1)
@@ -21,14 +21,17 @@
 #include <config.h>
 #include "system.h"
 
+#include <canonicalize.h>
 #include <configmake.h> /* PKGDATADIR */
 #include <error.h>
 #include <dirname.h>
 #include <get-errno.h>
+#include <intprops.h>
 #include <quote.h>
 #include <quotearg.h>
 #include <relocatable.h> /* relocate2 */
 #include <stdio-safer.h>
+#include <sys/stat.h>
 #include <xstrndup.h>
 
 #include "complain.h"
@@ -52,6 +55,7 @@ char *spec_verbose_file = NULL;  /* for --verbose. */
 char *spec_graph_file = NULL;    /* for -g. */
 char *spec_xml_file = NULL;      /* for -x. */
 char *spec_header_file = NULL;  /* for --defines. */
+char const *spec_changed_files = NULL; /* for --changed-files. */
 char *parser_file_name;
 
 /* All computed output file names.  */
@@ -156,6 +160,149 @@ xfdopen (int fd, char const *mode)
   return res;
 }
 
+/*-----------------------------------------------------------------.
+| The generated files being written, to a temporary file which    |
+| replaces the actual file only if the contents changed, so that  |
+| the timestamps of unchanged files are preserved, and dependent  |
+| files are not recompiled.                                       |
+`-----------------------------------------------------------------*/
+
+typedef struct
+{
+  FILE *out;
+  /* The name of the generated file.  */
+  char *name;
+  /* The file to replace: NAME, with its symbolic links resolved.  */
+  char *path;
+  /* The name of the temporary file.  */
+  char *tmp;
+  /* The permissions of PATH, if it exists.  */
+  mode_t mode;
+  bool exists;
+} output_stream;
+
+static output_stream *output_streams = NULL;
+static int output_streams_size = 0;
+
+/* Remove the temporary files of the streams that were not closed, on
+   fatal errors.  */
+static void
+output_streams_cleanup (void)
+{
+  for (int i = 0; i < output_streams_size; ++i)
+    unlink (output_streams[i].tmp);
+}
+
+FILE *
+xfopen_output (char const *name)
+{
+  /* Replace the file a symbolic link points to, not the link.  */
+  struct stat st;
+  char *path
+    = (lstat (name, &st) == 0 && S_ISLNK (st.st_mode)
+       ? canonicalize_filename_mode (name, CAN_MISSING)
+       : xstrdup (name));
+  bool exists = path && stat (path, &st) == 0;
+
+  /* Write directly to special files, such as /dev/null, and through
+     links that cannot be resolved.  */
+  if (!path || (exists && !S_ISREG (st.st_mode)))
+    {
+      free (path);
+      return xfopen (name, "w");
+    }
+
+  static bool cleanup_registered = false;
+  if (!cleanup_registered)
+    {
+      atexit (output_streams_cleanup);
+      cleanup_registered = true;
+    }
+
+  output_stream s;
+  s.name = xstrdup (name);
+  s.path = path;
+  s.mode = exists ? st.st_mode & 07777 : 0;
+  s.exists = exists;
+  /* In the same directory, so that rename is atomic.  */
+  s.tmp = xmalloc (strlen (path) + sizeof ".tmp" + INT_BUFSIZE_BOUND (long));
+  sprintf (s.tmp, "%s.tmp%ld", path, (long) getpid ());
+  s.out = xfopen (s.tmp, "w");
+  output_streams = xnrealloc (output_streams, ++output_streams_size,
+                              sizeof *output_streams);
+  output_streams[output_streams_size - 1] = s;
+  return s.out;
+}
+
+/* Whether the files NAME1 and NAME2 have the same contents.  */
+static bool
+same_contents (char const *name1, char const *name2)
+{
+  FILE *in1 = fopen (name1, "rb");
+  FILE *in2 = in1 ? fopen (name2, "rb") : NULL;
+  bool res = in1 && in2;
+  while (res)
+    {
+      char buf1[BUFSIZ];
+      char buf2[BUFSIZ];
+      size_t size1 = fread (buf1, 1, sizeof buf1, in1);
+      size_t size2 = fread (buf2, 1, sizeof buf2, in2);
+      res = size1 == size2 && memcmp (buf1, buf2, size1) == 0;
+      if (size1 < sizeof buf1)
+        {
+          res = res && !ferror (in1) && !ferror (in2);
+          break;
+        }
+    }
+  if (in1)
+    fclose (in1);
+  if (in2)
+    fclose (in2);
+  return res;
+}
+
+void
+xfclose_output (FILE *out)
+{
+  int i;
+  for (i = 0; i < output_streams_size; ++i)
+    if (output_streams[i].out == out)
+      break;
+  if (i == output_streams_size)
+    {
+      xfclose (out);
+      return;
+    }
+
+  output_stream s = output_streams[i];
+  output_streams[i] = output_streams[--output_streams_size];
+  xfclose (s.out);
+  if (same_contents (s.tmp, s.path))
+    unlink (s.tmp);
+  else
+    {
+      /* Keep the permissions of the file we replace.  */
+      if (s.exists)
+        chmod (s.tmp, s.mode);
+      if (rename (s.tmp, s.path) != 0)
+        {
+          int err = get_errno ();
+          unlink (s.tmp);
+          error (EXIT_FAILURE, err, _("cannot rename %s as %s"),
+                 quote (s.tmp), quote_n (1, s.path));
+        }
+      if (spec_changed_files)
+        {
+          FILE *list = xfopen (spec_changed_files, "a");
+          fprintf (list, "%s\n", s.name);
+          xfclose (list);
+        }
+    }
+  free (s.name);
+  free (s.path);
+  free (s.tmp);
+}
+
 /*------------------------------------------------------------------.
 | Compute ALL_BUT_EXT, ALL_BUT_TAB_EXT and output files extensions. |
 `------------------------------------------------------------------*/
@@ -50,6 +50,9 @@ extern char *spec_xml_file;
 /* File name specified with --defines.  */
 extern char *spec_header_file;
 
+/* File name specified with --changed-files.  */
+extern char const *spec_changed_files;
+
 /* Directory prefix of output file names.  */
 extern char *dir_prefix;
 
@@ -82,4 +85,12 @@ FILE *xfopen (const char *name, char const *mode);
 void xfclose (FILE *ptr);
 FILE *xfdopen (int fd, char const *mode);
 
+/* Open the generated file NAME for writing.  Its contents actually
+   goes to a temporary file, which xfclose_output moves to NAME only if
+   the contents of NAME differ, so that its timestamp is preserved
+   otherwise.  The files that changed are listed in
+   SPEC_CHANGED_FILES.  */
+FILE *xfopen_output (char const *name);
+void xfclose_output (FILE *out);
+
 #endif /* !FILES_H_ */
@@ -28,6 +28,7 @@
 #include <configmake.h>
 #include <error.h>
 #include <getopt.h>
+#include <nproc.h>
 #include <progname.h>
 #include <quote.h>
 #include <textstyle.h>
@@ -46,6 +47,11 @@ bool token_table_flag = false;
 location yacc_loc = EMPTY_LOCATION_INIT;
 bool update_flag = false; /* for -u */
 bool color_debug = false;
+int jobs = 1;
+char const *batch_file = NULL;
+bool server_flag = false;
+char const *cache_dir = NULL;
+char const *profile_file = NULL;
 
 bool nondeterministic_parser = false;
 bool glr_parser = false;
@@ -211,6 +217,7 @@ static const argmatch_report_doc argmatch_report_docs[] =
   { "lookaheads", N_("explicitly associate lookahead tokens to items") },
   { "solved",     N_("describe shift/reduce conflicts solving") },
   { "all",        N_("include all the above information") },
+  { "tables",     N_("size of the parser tables in each encoding") },
   { "none",       N_("disable the report") },
   { NULL, NULL },
 };
@@ -223,6 +230,7 @@ static const argmatch_report_arg argmatch_report_args[] =
   { "lookaheads",  report_states | report_lookahead_tokens },
   { "solved",      report_states | report_solved_conflicts },
   { "all",         report_all },
+  { "tables",      report_states | report_tables },
   { NULL, report_none },
 };
 
@@ -376,6 +384,15 @@ Operation Modes:\n\
       --print-datadir        output directory containing skeletons and XSLT\n\
                              and exit\n\
   -u, --update               apply fixes to the source grammar file and exit\n\
+      --jobs[=N]             build the LR(0) automaton with N threads (default:\n\
+                             number of processors); with --batch and --server,\n\
+                             run up to N jobs at a time\n\
+      --batch=FILE           run the jobs listed in FILE, one command line\n\
+                             per line, instead of processing FILE\n\
+      --cache-dir=DIR        reuse the parser tables saved in DIR by previous\n\
+                             runs on grammars with the same rules\n\
+      --server               run the jobs read from the standard input, and\n\
+                             report their exit status on the standard output\n\
   -f, --feature[=FEATURES]   activate miscellaneous features\n\
 \n\
 "), stdout);
@@ -422,6 +439,10 @@ Output Files:\n\
   -d                         likewise but cannot specify FILE (for POSIX Yacc)\n\
   -r, --report=THINGS        also produce details on the automaton\n\
       --report-file=FILE     write report to FILE\n\
+      --changed-files=FILE   append to FILE the names of the output files\n\
+                             whose contents changed\n\
+      --profile=FILE         write the time and memory spent in each phase,\n\
+                             and the sizes of the automaton, to FILE in JSON\n\
   -v, --verbose              same as '--report=state'\n\
   -b, --file-prefix=PREFIX   specify a PREFIX for output files\n\
   -o, --output=FILE          leave output to FILE\n\
@@ -560,12 +581,18 @@ static char const short_options[] =
 /* Values for long options that do not have single-letter equivalents.  */
 enum
 {
-  COLOR_OPTION = CHAR_MAX + 1,
+  BATCH_OPTION = CHAR_MAX + 1,
+  CACHE_DIR_OPTION,
+  CHANGED_FILES_OPTION,
+  COLOR_OPTION,
   FIXED_OUTPUT_FILES_OPTION,
+  JOBS_OPTION,
   LOCATIONS_OPTION,
   PRINT_DATADIR_OPTION,
   PRINT_LOCALEDIR_OPTION,
+  PROFILE_OPTION,
   REPORT_FILE_OPTION,
+  SERVER_OPTION,
   STYLE_OPTION
 };
 
@@ -579,6 +606,10 @@ static struct option const long_options[] =
   { "print-datadir",   no_argument,       0,   PRINT_DATADIR_OPTION   },
   { "update",          no_argument,       0,   'u' },
   { "feature",         optional_argument, 0,   'f' },
+  { "jobs",            optional_argument, 0,   JOBS_OPTION },
+  { "batch",           required_argument, 0,   BATCH_OPTION },
+  { "server",          no_argument,       0,   SERVER_OPTION },
+  { "cache-dir",       required_argument, 0,   CACHE_DIR_OPTION },
 
   /* Diagnostics.  */
   { "warnings",        optional_argument,  0, 'W' },
@@ -601,6 +632,8 @@ static struct option const long_options[] =
   { "defines",     optional_argument,   0,   'd' },
   { "report",      required_argument,   0,   'r' },
   { "report-file", required_argument,   0,   REPORT_FILE_OPTION },
+  { "changed-files", required_argument, 0,   CHANGED_FILES_OPTION },
+  { "profile",     required_argument,   0,   PROFILE_OPTION },
   { "verbose",     no_argument,         0,   'v' },
   { "file-prefix", required_argument,   0,   'b' },
   { "output",      required_argument,   0,   'o' },
@@ -807,6 +840,18 @@ getargs (int argc, char *argv[])
         yacc_loc = loc;
         break;
 
+      case BATCH_OPTION:
+        batch_file = optarg;
+        break;
+
+      case CACHE_DIR_OPTION:
+        cache_dir = optarg;
+        break;
+
+      case CHANGED_FILES_OPTION:
+        spec_changed_files = optarg;
+        break;
+
       case COLOR_OPTION:
         /* Handled in getargs_colors. */
         break;
@@ -818,6 +863,20 @@ getargs (int argc, char *argv[])
         spec_outfile = "y.tab.c";
         break;
 
+      case JOBS_OPTION:
+        if (optarg)
+          {
+            char *end;
+            long n = strtol (optarg, &end, 10);
+            if (*end || n < 1 || INT_MAX < n)
+              complain (&loc, fatal, _("invalid argument %s for %s"),
+                        quote (optarg), quote_n (1, "--jobs"));
+            jobs = n;
+          }
+        else
+          jobs = num_processors (NPROC_CURRENT);
+        break;
+
       case LOCATIONS_OPTION:
         muscle_percent_define_ensure ("locations", loc, true);
         break;
@@ -830,11 +889,19 @@ getargs (int argc, char *argv[])
         printf ("%s\n", pkgdatadir ());
         exit (EXIT_SUCCESS);
 
+      case PROFILE_OPTION:
+        profile_file = optarg;
+        break;
+
       case REPORT_FILE_OPTION:
         free (spec_verbose_file);
         spec_verbose_file = xstrdup (optarg);
         break;
 
+      case SERVER_OPTION:
+        server_flag = true;
+        break;
+
       case STYLE_OPTION:
         /* Handled in getargs_colors. */
         break;
@@ -844,6 +911,23 @@ getargs (int argc, char *argv[])
       }
   }
 
+  /* In batch mode, the grammar files are given by the jobs.  */
+  if (batch_file || server_flag)
+    {
+      if (batch_file && server_flag)
+        {
+          error (0, 0, _("%s and %s are incompatible"),
+                 quote ("--batch"), quote_n (1, "--server"));
+          usage (EXIT_FAILURE);
+        }
+      if (optind < argc)
+        {
+          error (0, 0, _("extra operand %s"), quote (argv[optind]));
+          usage (EXIT_FAILURE);
+        }
+      return;
+    }
+
   if (argc - optind != 1)
     {
       if (argc - optind < 1)
@@ -42,6 +42,11 @@ extern bool token_table_flag;           /* for -k */
 extern location yacc_loc;               /* for -y */
 extern bool update_flag;                /* for -u */
 extern bool color_debug;                /* --color=debug. */
+extern int jobs;                        /* for --jobs */
+extern char const *batch_file;          /* for --batch */
+extern bool server_flag;                /* for --server */
+extern char const *cache_dir;           /* for --cache-dir */
+extern char const *profile_file;        /* for --profile */
 /* GLR_PARSER is true if the input file says to use the GLR
    (Generalized LR) parser, and to output some additional information
    used by the GLR algorithm.  */
@@ -79,7 +84,10 @@ enum report
     report_itemsets         = 1 << 1,
     report_lookahead_tokens = 1 << 2,
     report_solved_conflicts = 1 << 3,
-    report_all              = ~0
+    report_tables           = 1 << 4,
+    /* Not report_tables, which must be requested explicitly, so that
+       "all" remains stable.  */
+    report_all              = ~report_tables
   };
 /** What appears in the *.output file.  */
 extern int report_flag;
@@ -23,7 +23,6 @@
 #include "ielr.h"
 
 #include <bitset.h>
-#include <timevar.h>
 
 #include "AnnotationList.h"
 #include "derives.h"
@@ -31,6 +30,7 @@
 #include "lalr.h"
 #include "muscle-tab.h"
 #include "nullable.h"
+#include "profile.h"
 #include "relation.h"
 #include "state.h"
 #include "symtab.h"
@@ -1024,7 +1024,7 @@ ielr_split_states (bitsetv follow_kernel_items, bitsetv always_follows,
      lookahead sets.  */
   if (!annotation_lists)
     {
-      timevar_push (tv_ielr_phase4);
+      profile_push (tv_ielr_phase4);
       initialize_LA ();
       for (state_list *node = first_state; node; node = node->next)
         if (!node->state->consistent)
@@ -1057,7 +1057,7 @@ ielr_split_states (bitsetv follow_kernel_items, bitsetv always_follows,
                   }
               }
           }
-      timevar_pop (tv_ielr_phase4);
+      profile_pop (tv_ielr_phase4);
     }
 
   /* Free state list.  */
@@ -1086,28 +1086,28 @@ ielr (void)
   switch (lr_type)
     {
     case LR_TYPE__LR0:
-      timevar_push (tv_lalr);
+      profile_push (tv_lalr);
       set_goto_map ();
-      timevar_pop (tv_lalr);
+      profile_pop (tv_lalr);
       return;
 
     case LR_TYPE__CANONICAL_LR:
-      timevar_push (tv_lalr);
+      profile_push (tv_lalr);
       set_goto_map ();
-      timevar_pop (tv_lalr);
+      profile_pop (tv_lalr);
       break;
 
     case LR_TYPE__LALR:
-      timevar_push (tv_lalr);
+      profile_push (tv_lalr);
       lalr ();
       bitsetv_free (goto_follows);
-      timevar_pop (tv_lalr);
+      profile_pop (tv_lalr);
       return;
 
     case LR_TYPE__IELR:
-      timevar_push (tv_lalr);
+      profile_push (tv_lalr);
       lalr ();
-      timevar_pop (tv_lalr);
+      profile_pop (tv_lalr);
       break;
     }
 
@@ -1122,14 +1122,14 @@ ielr (void)
     {
       /* Phase 1: Compute Auxiliary Tables.  */
       state ***predecessors;
-      timevar_push (tv_ielr_phase1);
+      profile_push (tv_ielr_phase1);
       ielr_compute_auxiliary_tables (
         &follow_kernel_items, &always_follows,
         lr_type == LR_TYPE__CANONICAL_LR ? NULL : &predecessors);
-      timevar_pop (tv_ielr_phase1);
+      profile_pop (tv_ielr_phase1);
 
       /* Phase 2: Compute Annotations.  */
-      timevar_push (tv_ielr_phase2);
+      profile_push (tv_ielr_phase2);
       if (lr_type != LR_TYPE__CANONICAL_LR)
         {
           obstack_init (&annotations_obstack);
@@ -1143,15 +1143,17 @@ ielr (void)
           bitsetv_free (goto_follows);
           lalr_free ();
         }
-      timevar_pop (tv_ielr_phase2);
+      profile_pop (tv_ielr_phase2);
     }
 
     /* Phase 3: Split States.  */
-    timevar_push (tv_ielr_phase3);
+    profile_push (tv_ielr_phase3);
     {
       state_number nstates_lr0 = nstates;
       ielr_split_states (follow_kernel_items, always_follows,
                          annotation_lists, max_annotations);
+      profile_count ("ielr_max_annotations", max_annotations);
+      profile_count ("ielr_split_states", nstates - nstates_lr0);
       if (inadequacy_lists)
         for (state_number i = 0; i < nstates_lr0; ++i)
           InadequacyList__delete (inadequacy_lists[i]);
@@ -1162,14 +1164,12 @@ ielr (void)
     free (annotation_lists);
     bitsetv_free (follow_kernel_items);
     bitsetv_free (always_follows);
-    timevar_pop (tv_ielr_phase3);
+    profile_pop (tv_ielr_phase3);
   }
 
   /* Phase 4: Compute Reduction Lookaheads.  */
-  timevar_push (tv_ielr_phase4);
-  free (goto_map);
-  free (from_state);
-  free (to_state);
+  profile_push (tv_ielr_phase4);
+  goto_map_free ();
   if (lr_type == LR_TYPE__CANONICAL_LR)
     {
       /* Reduction lookaheads are computed in ielr_split_states above
@@ -1181,5 +1181,5 @@ ielr (void)
       lalr ();
       bitsetv_free (goto_follows);
     }
-  timevar_pop (tv_ielr_phase4);
+  profile_pop (tv_ielr_phase4);
 }
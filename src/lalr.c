@@ -36,6 +36,7 @@
 #include "lr0.h"
 #include "muscle-tab.h"
 #include "nullable.h"
+#include "profile.h"
 #include "reader.h"
 #include "relation.h"
 #include "symtab.h"
@@ -47,6 +48,13 @@ state_number *from_state = NULL;
 state_number *to_state = NULL;
 bitsetv goto_follows = NULL;
 
+/* An index of the gotos keyed by (source state, nterm), so that
+   map_goto runs in constant time.  Open addressing with linear
+   probing; the capacity is a power of two larger than twice NGOTOS.
+   Empty slots contain GOTO_NUMBER_MAXIMUM.  */
+static goto_number *goto_index = NULL;
+static size_t goto_index_mask = 0;
+
 /* Linked list of goto numbers.  */
 typedef struct goto_list
 {
@@ -71,6 +79,11 @@ goto_list_new (goto_number value, struct goto_list *next)
 static bitsetv LA = NULL;
 size_t nLA;
 
+unsigned lookahead_attrs = BITSET_FIXED;
+
+/* The largest size, in bytes, of the dense lookahead sets.  */
+enum { lookahead_dense_max = 64 * 1024 * 1024 };
+
 
 /* "(p, A) includes (p', B)" iff
    B → βAγ, γ nullable, and p'-- β --> p (i.e., state p' reaches p on label β).
@@ -95,6 +108,42 @@ goto_print (goto_number i, FILE *out)
            "goto[%ld] = (%d, %s, %d)", i, src, symbols[var]->tag, dst);
 }
 
+static size_t
+goto_index_hash (state_number src, symbol_number sym)
+{
+  uint64_t res = (uint64_t) src * (uint64_t) nvars + (sym - ntokens);
+  res ^= res >> 33;
+  res *= UINT64_C (0xff51afd7ed558ccd);
+  res ^= res >> 33;
+  res *= UINT64_C (0xc4ceb9fe1a85ec53);
+  res ^= res >> 33;
+  return res;
+}
+
+/* Build GOTO_INDEX from GOTO_MAP and FROM_STATE.  */
+static void
+goto_index_build (void)
+{
+  size_t capacity = 16;
+  while (capacity / 2 <= ngotos)
+    capacity *= 2;
+  free (goto_index);
+  goto_index = xnmalloc (capacity, sizeof *goto_index);
+  goto_index_mask = capacity - 1;
+  for (size_t i = 0; i < capacity; ++i)
+    goto_index[i] = GOTO_NUMBER_MAXIMUM;
+
+  for (symbol_number sym = ntokens; sym < nsyms; ++sym)
+    for (goto_number g = goto_map[sym - ntokens];
+         g < goto_map[sym - ntokens + 1]; ++g)
+      {
+        size_t i = goto_index_hash (from_state[g], sym) & goto_index_mask;
+        while (goto_index[i] != GOTO_NUMBER_MAXIMUM)
+          i = (i + 1) & goto_index_mask;
+        goto_index[i] = g;
+      }
+}
+
 void
 set_goto_map (void)
 {
@@ -144,6 +193,7 @@ set_goto_map (void)
     }
 
   free (temp_map);
+  goto_index_build ();
 
   if (trace_flag & trace_automaton)
     for (int i = 0; i < ngotos; ++i)
@@ -154,23 +204,35 @@ set_goto_map (void)
 }
 
 
+void
+goto_map_free (void)
+{
+  free (goto_map);
+  goto_map = NULL;
+  free (from_state);
+  from_state = NULL;
+  free (to_state);
+  to_state = NULL;
+  free (goto_index);
+  goto_index = NULL;
+  goto_index_mask = 0;
+}
+
+
 goto_number
 map_goto (state_number src, symbol_number sym)
 {
+  /* The gotos labeled with SYM.  */
   goto_number low = goto_map[sym - ntokens];
-  goto_number high = goto_map[sym - ntokens + 1] - 1;
+  goto_number high = goto_map[sym - ntokens + 1];
 
-  for (;;)
+  for (size_t i = goto_index_hash (src, sym) & goto_index_mask;;
+       i = (i + 1) & goto_index_mask)
     {
-      aver (low <= high);
-      goto_number middle = (low + high) / 2;
-      state_number s = from_state[middle];
-      if (s == src)
-        return middle;
-      else if (s < src)
-        low = middle + 1;
-      else
-        high = middle - 1;
+      goto_number g = goto_index[i];
+      aver (g != GOTO_NUMBER_MAXIMUM);
+      if (low <= g && g < high && from_state[g] == src)
+        return g;
     }
 }
 
@@ -200,7 +262,7 @@ initialize_goto_follows (void)
   goto_number **reads = xnmalloc (ngotos, sizeof *reads);
   goto_number *edge = xnmalloc (ngotos, sizeof *edge);
 
-  goto_follows = bitsetv_create (ngotos, ntokens, BITSET_FIXED);
+  goto_follows = bitsetv_create (ngotos, ntokens, lookahead_attrs);
 
   for (goto_number i = 0; i < ngotos; ++i)
     {
@@ -316,7 +378,16 @@ static void
 build_relations (void)
 {
   goto_number *edge = xnmalloc (ngotos, sizeof *edge);
-  state_number *path = xnmalloc (ritem_longest_rhs () + 1, sizeof *path);
+  /* The gotos taken along PATH: path_gotos[p] is the goto from the
+     p-th state of PATH labeled with the p-th symbol of the RHS, when
+     this symbol is an nterm.  */
+  goto_number *path_gotos
+    = xnmalloc (ritem_longest_rhs () + 1, sizeof *path_gotos);
+  /* edge_stamp[g] == i iff G is already in EDGE while processing goto
+     I.  Saves a linear search in EDGE for each insertion.  */
+  goto_number *edge_stamp = xnmalloc (ngotos, sizeof *edge_stamp);
+  for (goto_number i = 0; i < ngotos; ++i)
+    edge_stamp[i] = GOTO_NUMBER_MAXIMUM;
 
   includes = xnmalloc (ngotos, sizeof *includes);
 
@@ -335,15 +406,21 @@ build_relations (void)
         {
           rule const *r = *rulep;
           state *s = states[src];
-          path[0] = s->number;
 
           /* Length of PATH.  */
           int length = 1;
           for (item_number const *rp = r->rhs; 0 <= *rp; rp++)
             {
               symbol_number sym = item_number_as_symbol_number (*rp);
-              s = transitions_to (s, sym);
-              path[length++] = s->number;
+              if (ISVAR (sym))
+                {
+                  goto_number g = map_goto (s->number, sym);
+                  path_gotos[length - 1] = g;
+                  s = states[to_state[g]];
+                }
+              else
+                s = transitions_to (s, sym);
+              ++length;
             }
 
           /* S is the end of PATH.  */
@@ -358,19 +435,14 @@ build_relations (void)
           for (int p = length - 2; 0 <= p && ISVAR (r->rhs[p]); --p)
             {
               symbol_number sym = item_number_as_symbol_number (r->rhs[p]);
-              goto_number g = map_goto (path[p], sym);
-              /* Insert G if not already in EDGE.
-                 FIXME: linear search.  A bitset instead?  */
-              {
-                bool found = false;
-                for (int j = 0; !found && j < nedges; ++j)
-                  found = edge[j] == g;
-                if (!found)
-                  {
-                    assert (nedges < ngotos);
-                    edge[nedges++] = g;
-                  }
-              }
+              goto_number g = path_gotos[p];
+              /* Insert G if not already in EDGE.  */
+              if (edge_stamp[g] != i)
+                {
+                  assert (nedges < ngotos);
+                  edge_stamp[g] = i;
+                  edge[nedges++] = g;
+                }
               if (!nullable[sym - ntokens])
                 break;
             }
@@ -400,7 +472,8 @@ build_relations (void)
     }
 
   free (edge);
-  free (path);
+  free (edge_stamp);
+  free (path_gotos);
 
   relation_transpose (&includes, ngotos);
   if (trace_flag & trace_automaton)
@@ -473,6 +546,37 @@ state_lookahead_tokens_count (state *s, bool default_reduction_only_for_accept)
 }
 
 
+/*------------------------------------------------------------------.
+| Choose LOOKAHEAD_ATTRS.  Dense bitsets are the fastest, but they   |
+| take (NGOTOS + NLA) * NTOKENS bits, which is too much for grammars |
+| with thousands of tokens and hundreds of thousands of gotos: most  |
+| of their lookahead sets hold only a few tokens.  Sparse bitsets    |
+| store only the non-empty words.  IELR(1) and canonical LR(1)       |
+| combine these sets with their own dense sets, so they keep dense   |
+| ones.                                                              |
+|                                                                    |
+| The undocumented %define lr.lookahead-sets (auto, dense, sparse)   |
+| forces the choice for LALR(1), for developers.                     |
+`------------------------------------------------------------------*/
+
+static void
+lookahead_attrs_choose (void)
+{
+  char *type = muscle_percent_define_get ("lr.type");
+  char *sets = muscle_percent_define_get ("lr.lookahead-sets");
+  double dense = (double) (ngotos + nLA) * ntokens / CHAR_BIT;
+  lookahead_attrs = (STREQ (type, "lalr")
+                     && (STREQ (sets, "sparse")
+                         || (STREQ (sets, "auto")
+                             && lookahead_dense_max < dense))
+                     ? BITSET_SPARSE : BITSET_FIXED);
+  free (sets);
+  free (type);
+  profile_count ("lookahead_dense_bytes", (long) dense);
+  profile_count ("lookahead_sparse", lookahead_attrs == BITSET_SPARSE);
+}
+
+
 /*----------------------------------------------------.
 | Compute LA, NLA, and the lookahead_tokens members.  |
 `----------------------------------------------------*/
@@ -498,7 +602,8 @@ initialize_LA (void)
   if (!nLA)
     nLA = 1;
 
-  bitsetv pLA = LA = bitsetv_create (nLA, ntokens, BITSET_FIXED);
+  lookahead_attrs_choose ();
+  bitsetv pLA = LA = bitsetv_create (nLA, ntokens, lookahead_attrs);
 
   /* Initialize the members LOOKAHEAD_TOKENS for each state whose reductions
      require lookahead tokens.  */
@@ -558,13 +663,16 @@ lalr (void)
       end_use_class ("trace0", stderr);
       fputc ('\n', stderr);
     }
-  initialize_LA ();
+  /* The size of the lookahead sets depends on NGOTOS.  */
   set_goto_map ();
+  initialize_LA ();
   initialize_goto_follows ();
   lookback = xcalloc (nLA, sizeof *lookback);
   build_relations ();
   compute_follows ();
   compute_lookahead_tokens ();
+  profile_count ("ngotos", ngotos);
+  profile_count ("nLA", nLA);
 
   if (trace_flag & trace_sets)
     lookahead_tokens_print (stderr);
@@ -607,6 +715,7 @@ lalr_update_state_numbers (state_number old_to_new[], state_number nstates_old)
       goto_map[nonterminal++] = ngotos_reachable;
     }
   ngotos = ngotos_reachable;
+  goto_index_build ();
 }
 
 
@@ -45,8 +45,8 @@
 void lalr (void);
 
 /**
- * Set #nLA and allocate all reduction lookahead sets.  Normally invoked by
- * #lalr.
+ * Set #nLA and #lookahead_attrs, and allocate all reduction lookahead sets.
+ * Normally invoked by #lalr, after #set_goto_map.
  */
 void initialize_LA (void);
 
@@ -96,10 +96,22 @@ extern state_number *from_state;
 /** State number it leads to.  */
 extern state_number *to_state;
 
-/** The number of the goto from state SRC labeled with nterm SYM.  */
+/** The number of the goto from state SRC labeled with nterm SYM.
+    Runs in constant time (expected).  */
 goto_number map_goto (state_number src, symbol_number sym);
 
+/** Release #goto_map, #from_state, #to_state and the index used by
+    #map_goto.  */
+void goto_map_free (void);
+
 /* goto_follows[i] is the set of tokens following goto i.  */
 extern bitsetv goto_follows;
 
+/** The attributes of the bitsets of #goto_follows and of the
+    lookahead_tokens of the reductions: BITSET_SPARSE for large LALR(1)
+    automata, BITSET_FIXED otherwise.  Bitsets combined with them
+    (bitset_or, bitset_and, etc.) must be created with these
+    attributes.  */
+extern unsigned lookahead_attrs;
+
 #endif /* !LALR_H_ */
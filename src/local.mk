@@ -34,6 +34,10 @@ src_bison_SOURCES =                             \
   src/Sbitset.h                                 \
   src/assoc.c                                   \
   src/assoc.h                                   \
+  src/batch.c                                   \
+  src/batch.h                                   \
+  src/cache.c                                   \
+  src/cache.h                                   \
   src/closure.c                                 \
   src/closure.h                                 \
   src/complain.c                                \
@@ -77,6 +81,8 @@ src_bison_SOURCES =                             \
   src/print-xml.h                               \
   src/print.c                                   \
   src/print.h                                   \
+  src/profile.c                                 \
+  src/profile.h                                 \
   src/reader.c                                  \
   src/reader.h                                  \
   src/reduce.c                                  \
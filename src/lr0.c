@@ -26,6 +26,7 @@
 #include "system.h"
 
 #include <bitset.h>
+#include <glthread/thread.h>
 
 #include "closure.h"
 #include "complain.h"
@@ -38,14 +39,10 @@
 #include "state.h"
 #include "symtab.h"
 
-typedef struct state_list
-{
-  struct state_list *next;
-  state *state;
-} state_list;
-
-static state_list *first_state = NULL;
-static state_list *last_state = NULL;
+/* The states discovered so far, indexed by their number: the
+   processing queue.  Eventually becomes STATES.  */
+static state **state_queue = NULL;
+static size_t state_queue_alloc = 0;
 
 /* Print CORE for debugging. */
 static void
@@ -67,50 +64,57 @@ core_print (size_t core_size, item_number *core, FILE *out)
 static state *
 state_list_append (symbol_number sym, size_t core_size, item_number *core)
 {
-  state_list *node = xmalloc (sizeof *node);
   state *res = state_new (sym, core_size, core);
 
   if (trace_flag & trace_automaton)
     fprintf (stderr, "state_list_append (state = %d, symbol = %d (%s))\n",
              nstates, sym, symbols[sym]->tag);
 
-  node->next = NULL;
-  node->state = res;
-
-  if (!first_state)
-    first_state = node;
-  if (last_state)
-    last_state->next = node;
-  last_state = node;
+  if (state_queue_alloc <= res->number)
+    state_queue = x2nrealloc (state_queue, &state_queue_alloc,
+                              sizeof *state_queue);
+  state_queue[res->number] = res;
 
   return res;
 }
 
-/* Symbols that can be "shifted" (including non terminals) from the
-   current state.  */
-bitset shift_symbol;
+/* Scratch space used to explore a state: compute its closure, its
+   reductions, and the kernels of its successors.  In serial mode, a
+   single instance is used; in parallel mode (see --jobs), each worker
+   has its own.  */
+typedef struct
+{
+  /* Where the closure of the state is computed.  */
+  closure_context *closure;
+
+  /* Symbols that can be "shifted" (including non terminals) from the
+     current state.  */
+  bitset shift_symbol;
 
-static rule **redset;
-/* For the current state, the list of pointers to states that can be
-   reached via a shift/goto.  Could be indexed by the reaching symbol,
-   but labels of incoming transitions can be recovered by the state
-   itself.  */
-static state **shiftset;
+  rule **redset;
 
+  /* For the current state, the list of pointers to states that can be
+     reached via a shift/goto.  Could be indexed by the reaching
+     symbol, but labels of incoming transitions can be recovered by the
+     state itself.  */
+  state **shiftset;
 
-/* KERNEL_BASE[symbol-number] -> list of item numbers (offsets inside
-   RITEM) of length KERNEL_SIZE[symbol-number]. */
-static item_number **kernel_base;
-static int *kernel_size;
+  /* KERNEL_BASE[symbol-number] -> list of item numbers (offsets inside
+     RITEM) of length KERNEL_SIZE[symbol-number]. */
+  item_number **kernel_base;
+  int *kernel_size;
 
-/* A single dimension array that serves as storage for
-   KERNEL_BASE.  */
-static item_number *kernel_items;
+  /* A single dimension array that serves as storage for
+     KERNEL_BASE.  */
+  item_number *kernel_items;
+} lr0_scratch;
 
-
-static void
-allocate_itemsets (void)
+
+static lr0_scratch *
+lr0_scratch_new (void)
 {
+  lr0_scratch *res = xmalloc (sizeof *res);
+
   /* Count the number of occurrences of all the symbols in RITEMS.
      Note that useless productions (hence useless nonterminals) are
      browsed too, hence we need to allocate room for _all_ the
@@ -133,61 +137,72 @@ allocate_itemsets (void)
      appears as an item, which is SYMBOL_COUNT[S].
      We allocate that much space for each symbol.  */
 
-  kernel_base = xnmalloc (nsyms, sizeof *kernel_base);
-  kernel_items = xnmalloc (count, sizeof *kernel_items);
+  res->kernel_base = xnmalloc (nsyms, sizeof *res->kernel_base);
+  res->kernel_items = xnmalloc (count, sizeof *res->kernel_items);
 
   count = 0;
   for (symbol_number i = 0; i < nsyms; i++)
     {
-      kernel_base[i] = kernel_items + count;
+      res->kernel_base[i] = res->kernel_items + count;
       count += symbol_count[i];
     }
 
   free (symbol_count);
-  kernel_size = xnmalloc (nsyms, sizeof *kernel_size);
+  res->kernel_size = xnmalloc (nsyms, sizeof *res->kernel_size);
+
+  res->closure = closure_context_new ();
+  res->shift_symbol = bitset_create (nsyms, BITSET_FIXED);
+  res->redset = xnmalloc (nrules, sizeof *res->redset);
+  res->shiftset = xnmalloc (nsyms, sizeof *res->shiftset);
+  return res;
+}
+
+
+static void
+lr0_scratch_free (lr0_scratch *scratch)
+{
+  closure_context_free (scratch->closure);
+  bitset_free (scratch->shift_symbol);
+  free (scratch->redset);
+  free (scratch->shiftset);
+  free (scratch->kernel_base);
+  free (scratch->kernel_size);
+  free (scratch->kernel_items);
+  free (scratch);
 }
 
+
 /* Print the current kernel (in KERNEL_BASE). */
 static void
-kernel_print (FILE *out)
+kernel_print (lr0_scratch const *scratch, FILE *out)
 {
   for (symbol_number i = 0; i < nsyms; ++i)
-    if (kernel_size[i])
+    if (scratch->kernel_size[i])
       {
         fprintf (out, "kernel[%s] =\n", symbols[i]->tag);
-        core_print (kernel_size[i], kernel_base[i], out);
+        core_print (scratch->kernel_size[i], scratch->kernel_base[i], out);
       }
 }
 
 /* Make sure the kernel is in sane state. */
 static void
-kernel_check (void)
+kernel_check (lr0_scratch const *scratch)
 {
   for (symbol_number i = 0; i < nsyms - 1; ++i)
-    assert (kernel_base[i] + kernel_size[i] <= kernel_base[i + 1]);
+    assert (scratch->kernel_base[i] + scratch->kernel_size[i]
+            <= scratch->kernel_base[i + 1]);
 }
 
 static void
 allocate_storage (void)
 {
-  allocate_itemsets ();
-
-  shiftset = xnmalloc (nsyms, sizeof *shiftset);
-  redset = xnmalloc (nrules, sizeof *redset);
   state_hash_new ();
-  shift_symbol = bitset_create (nsyms, BITSET_FIXED);
 }
 
 
 static void
 free_storage (void)
 {
-  bitset_free (shift_symbol);
-  free (redset);
-  free (shiftset);
-  free (kernel_base);
-  free (kernel_size);
-  free (kernel_items);
   state_hash_free ();
 }
 
@@ -209,43 +224,46 @@ free_storage (void)
 `------------------------------------------------------------------*/
 
 static void
-new_itemsets (state *s)
+new_itemsets (lr0_scratch *scratch, state *s)
 {
   if (trace_flag & trace_automaton)
     fprintf (stderr, "new_itemsets: begin: state = %d\n", s->number);
 
-  memset (kernel_size, 0, nsyms * sizeof *kernel_size);
+  memset (scratch->kernel_size, 0, nsyms * sizeof *scratch->kernel_size);
 
-  bitset_zero (shift_symbol);
+  bitset_zero (scratch->shift_symbol);
 
   if (trace_flag & trace_automaton)
     {
       fprintf (stderr, "initial kernel:\n");
-      kernel_print (stderr);
+      kernel_print (scratch, stderr);
     }
 
-  for (size_t i = 0; i < nitemset; ++i)
-    if (item_number_is_symbol_number (ritem[itemset[i]]))
+  closure_context const *cl = scratch->closure;
+  for (size_t i = 0; i < cl->nitemset; ++i)
+    if (item_number_is_symbol_number (ritem[cl->itemset[i]]))
       {
         if (trace_flag & trace_automaton)
           {
             fputs ("working on: ", stderr);
-            item_print (ritem + itemset[i], NULL, stderr);
+            item_print (ritem + cl->itemset[i], NULL, stderr);
             fputc ('\n', stderr);
           }
-        symbol_number sym = item_number_as_symbol_number (ritem[itemset[i]]);
-        bitset_set (shift_symbol, sym);
-        kernel_base[sym][kernel_size[sym]] = itemset[i] + 1;
-        kernel_size[sym]++;
+        symbol_number sym
+          = item_number_as_symbol_number (ritem[cl->itemset[i]]);
+        bitset_set (scratch->shift_symbol, sym);
+        scratch->kernel_base[sym][scratch->kernel_size[sym]]
+          = cl->itemset[i] + 1;
+        scratch->kernel_size[sym]++;
       }
 
   if (trace_flag & trace_automaton)
     {
       fprintf (stderr, "final kernel:\n");
-      kernel_print (stderr);
+      kernel_print (scratch, stderr);
       fprintf (stderr, "new_itemsets: end: state = %d\n\n", s->number);
     }
-  kernel_check ();
+  kernel_check (scratch);
 }
 
 
@@ -285,7 +303,7 @@ get_state (symbol_number sym, size_t core_size, item_number *core)
 `---------------------------------------------------------------*/
 
 static void
-append_states (state *s)
+append_states (lr0_scratch *scratch, state *s)
 {
   if (trace_flag & trace_automaton)
     fprintf (stderr, "append_states: begin: state = %d\n", s->number);
@@ -293,9 +311,10 @@ append_states (state *s)
   bitset_iterator iter;
   symbol_number sym;
   int i = 0;
-  BITSET_FOR_EACH (iter, shift_symbol, sym, 0)
+  BITSET_FOR_EACH (iter, scratch->shift_symbol, sym, 0)
     {
-      shiftset[i] = get_state (sym, kernel_size[sym], kernel_base[sym]);
+      scratch->shiftset[i] = get_state (sym, scratch->kernel_size[sym],
+                                        scratch->kernel_base[sym]);
       ++i;
     }
 
@@ -306,26 +325,28 @@ append_states (state *s)
 
 /*----------------------------------------------------------------.
 | Find which rules can be used for reduction transitions from the |
-| current state and make a reductions structure for the state to  |
-| record their rule numbers.                                      |
+| current state and store them in REDSET.  Return their number.   |
 `----------------------------------------------------------------*/
 
-static void
-save_reductions (state *s)
+static int
+find_reductions (lr0_scratch *scratch, state *s)
 {
   int count = 0;
 
   /* Find and count the active items that represent ends of rules. */
-  for (size_t i = 0; i < nitemset; ++i)
+  closure_context const *cl = scratch->closure;
+  for (size_t i = 0; i < cl->nitemset; ++i)
     {
-      item_number item = ritem[itemset[i]];
+      item_number item = ritem[cl->itemset[i]];
       if (item_number_is_rule_number (item))
         {
           rule_number r = item_number_as_rule_number (item);
-          redset[count++] = &rules[r];
+          scratch->redset[count++] = &rules[r];
           if (r == 0)
             {
-              /* This is "reduce 0", i.e., accept. */
+              /* This is "reduce 0", i.e., accept.  There is a single
+                 such state, so even in parallel mode, there is no
+                 race on FINAL_STATE.  */
               aver (!final_state);
               final_state = s;
             }
@@ -337,17 +358,256 @@ save_reductions (state *s)
       fprintf (stderr, "reduction[%d] = {\n", s->number);
       for (int i = 0; i < count; ++i)
         {
-          rule_print (redset[i], NULL, stderr);
+          rule_print (scratch->redset[i], NULL, stderr);
           fputc ('\n', stderr);
         }
       fputs ("}\n", stderr);
     }
 
-  /* Make a reductions structure and copy the data into it.  */
-  state_reductions_set (s, count, redset);
+  return count;
+}
+
+
+/*------------------------------------------------------------------.
+| Compute the closure of S, its reductions (in REDSET, return their |
+| number), and the kernels of its successors (in SCRATCH).  Does    |
+| not allocate anything in the automaton, so it can be run          |
+| concurrently on different states with different SCRATCHes.       |
+`------------------------------------------------------------------*/
+
+static int
+explore_state (lr0_scratch *scratch, state *s)
+{
+  /* Set up itemset for the transitions out of this state.  itemset gets a
+     vector of all the items that could be accepted next.  */
+  closure_context_compute (scratch->closure, s->items, s->nitems);
+  /* Find the reductions allowed out of this state.  */
+  int res = find_reductions (scratch, s);
+  /* Find the itemsets of the states that shifts/gotos can reach.  */
+  new_itemsets (scratch, s);
+  return res;
 }
 
-
+
+/*---------------------------------------------------------------.
+| Process the queued states one at a time, in the order they are |
+| discovered.                                                    |
+`---------------------------------------------------------------*/
+
+static void
+generate_states_serial (void)
+{
+  lr0_scratch *scratch = lr0_scratch_new ();
+
+  /* States are queued when they are created; process them all.  */
+  for (state_number i = 0; i < nstates; ++i)
+    {
+      state *s = state_queue[i];
+      if (trace_flag & trace_automaton)
+        fprintf (stderr, "Processing state %d (reached by %s)\n",
+                 s->number,
+                 symbols[s->accessing_symbol]->tag);
+      /* Record the reductions allowed out of this state.  */
+      int nreds = explore_state (scratch, s);
+      state_reductions_set (s, nreds, scratch->redset);
+      /* Find or create the core structures for those states.  */
+      append_states (scratch, s);
+
+      /* Create the shifts structures for the shifts to those states,
+         now that the state numbers transitioning to are known.  */
+      state_transitions_set (s, bitset_count (scratch->shift_symbol),
+                             scratch->shiftset);
+    }
+
+  lr0_scratch_free (scratch);
+}
+
+
+                        /*----------------.
+                        | Parallel mode.  |
+                        `----------------*/
+
+/* In parallel mode, the states are processed by waves: a wave is the
+   set of states discovered while processing the previous wave.  The
+   states of a wave are explored concurrently (closure, reductions,
+   kernels), and for each successor, we look for an existing state in
+   the hash table, which is not modified during the exploration.
+   Then, the reductions are recorded and the successors that were not
+   found are created serially, in the order in which
+   generate_states_serial would have created them, so state numbers,
+   and therefore the output, do not depend on the number of jobs.  The
+   automaton storage (see state.c) is not thread safe, so nothing is
+   allocated in it during the exploration.  */
+
+/* The successors and reductions of a state, as computed during the
+   exploration of a wave.  */
+typedef struct
+{
+  /* The reductions.  */
+  int nreds;
+  rule **reds;
+  /* Number of successors.  */
+  int num;
+  /* For each successor, its accessing symbol, its core, and the
+     existing state with this core if there was one when the wave
+     started.  */
+  symbol_number *syms;
+  size_t *core_sizes;
+  item_number **cores;
+  state **found;
+} successors;
+
+/* What a worker thread is to explore.  */
+typedef struct
+{
+  lr0_scratch *scratch;
+  /* Storage for SUCCS.  */
+  struct obstack obstack;
+  /* The states of the wave this worker is in charge of, and where to
+     store their successors.  */
+  state **states;
+  successors *succs;
+  size_t nstates;
+} lr0_worker;
+
+/* Waves smaller than this are explored by the main thread only: it is
+   not worth starting threads for so few states.  */
+#define LR0_WAVE_MIN 64
+
+static void
+explore_successors (lr0_worker *w, state *s, successors *succ)
+{
+  lr0_scratch *scratch = w->scratch;
+  succ->nreds = explore_state (scratch, s);
+  succ->reds = obstack_copy (&w->obstack, scratch->redset,
+                             succ->nreds * sizeof *scratch->redset);
+
+  int num = bitset_count (scratch->shift_symbol);
+  succ->num = num;
+  succ->syms = obstack_alloc (&w->obstack, num * sizeof *succ->syms);
+  succ->core_sizes
+    = obstack_alloc (&w->obstack, num * sizeof *succ->core_sizes);
+  succ->cores = obstack_alloc (&w->obstack, num * sizeof *succ->cores);
+  succ->found = obstack_alloc (&w->obstack, num * sizeof *succ->found);
+
+  bitset_iterator iter;
+  symbol_number sym;
+  int i = 0;
+  BITSET_FOR_EACH (iter, scratch->shift_symbol, sym, 0)
+    {
+      size_t size = scratch->kernel_size[sym];
+      succ->syms[i] = sym;
+      succ->core_sizes[i] = size;
+      succ->cores[i] = obstack_copy (&w->obstack, scratch->kernel_base[sym],
+                                     size * sizeof *scratch->kernel_base[sym]);
+      succ->found[i] = state_hash_lookup (size, succ->cores[i]);
+      ++i;
+    }
+}
+
+static void *
+lr0_worker_run (void *arg)
+{
+  lr0_worker *w = arg;
+  for (size_t i = 0; i < w->nstates; ++i)
+    explore_successors (w, w->states[i], &w->succs[i]);
+  return NULL;
+}
+
+/* Explore the NWAVE states of WAVE, storing their successors in
+   SUCCS, using up to NWORKERS of the WORKERS.  */
+static void
+explore_wave (lr0_worker *workers, int nworkers,
+              state **wave, successors *succs, size_t nwave)
+{
+  if (nwave < LR0_WAVE_MIN)
+    nworkers = 1;
+  gl_thread_t *threads = xnmalloc (nworkers, sizeof *threads);
+  bool *started = xnmalloc (nworkers, sizeof *started);
+  for (int i = 0; i < nworkers; ++i)
+    {
+      size_t lo = nwave * i / nworkers;
+      size_t hi = nwave * (i + 1) / nworkers;
+      workers[i].states = wave + lo;
+      workers[i].succs = succs + lo;
+      workers[i].nstates = hi - lo;
+      /* Worker 0 is the main thread.  If a thread cannot be started,
+         the main thread does its job.  */
+      started[i] = 0 < i && !glthread_create (&threads[i], lr0_worker_run,
+                                              &workers[i]);
+    }
+  for (int i = 0; i < nworkers; ++i)
+    if (!started[i])
+      lr0_worker_run (&workers[i]);
+  for (int i = 1; i < nworkers; ++i)
+    if (started[i])
+      glthread_join (threads[i], NULL);
+  free (started);
+  free (threads);
+}
+
+static void
+generate_states_parallel (int nworkers)
+{
+  lr0_worker *workers = xnmalloc (nworkers, sizeof *workers);
+  for (int i = 0; i < nworkers; ++i)
+    {
+      workers[i].scratch = lr0_scratch_new ();
+      obstack_init (&workers[i].obstack);
+    }
+  state **shiftset = xnmalloc (nsyms, sizeof *shiftset);
+
+  size_t succs_alloc = 0;
+  successors *succs = NULL;
+
+  /* The first state of the current wave.  */
+  state_number first = 0;
+  while (first < nstates)
+    {
+      /* The wave: the states queued so far, and not yet processed.  */
+      state **wave = state_queue + first;
+      size_t nwave = nstates - first;
+      if (succs_alloc < nwave)
+        {
+          succs_alloc = nwave;
+          succs = xnrealloc (succs, succs_alloc, sizeof *succs);
+        }
+      first = nstates;
+
+      explore_wave (workers, nworkers, wave, succs, nwave);
+
+      /* Commit: create the new states in the same order as in serial
+         mode.  Beware that this reallocates STATE_QUEUE, hence WAVE.  */
+      for (size_t i = 0; i < nwave; ++i)
+        {
+          state *s = state_queue[first - nwave + i];
+          successors *succ = &succs[i];
+          state_reductions_set (s, succ->nreds, succ->reds);
+          for (int j = 0; j < succ->num; ++j)
+            shiftset[j] = succ->found[j]
+              ? succ->found[j]
+              : get_state (succ->syms[j], succ->core_sizes[j], succ->cores[j]);
+          state_transitions_set (s, succ->num, shiftset);
+        }
+
+      for (int i = 0; i < nworkers; ++i)
+        {
+          obstack_free (&workers[i].obstack, NULL);
+          obstack_init (&workers[i].obstack);
+        }
+    }
+
+  free (succs);
+  free (shiftset);
+  for (int i = 0; i < nworkers; ++i)
+    {
+      lr0_scratch_free (workers[i].scratch);
+      obstack_free (&workers[i].obstack, NULL);
+    }
+  free (workers);
+}
+
+
 /*---------------.
 | Build STATES.  |
 `---------------*/
@@ -355,29 +615,22 @@ save_reductions (state *s)
 static void
 set_states (void)
 {
-  states = xcalloc (nstates, sizeof *states);
-
-  while (first_state)
+  states = xnrealloc (state_queue, nstates, sizeof *states);
+  state_queue = NULL;
+  state_queue_alloc = 0;
+
+  /* Pessimization, but simplification of the code: make sure all the
+     states have valid transitions and reductions members, even if
+     reduced to 0.  It is too soon for errs, which are computed later,
+     but set_conflicts.  */
+  for (state_number i = 0; i < nstates; ++i)
     {
-      state_list *this = first_state;
-
-      /* Pessimization, but simplification of the code: make sure all
-         the states have valid transitions and reductions members,
-         even if reduced to 0.  It is too soon for errs, which are
-         computed later, but set_conflicts.  */
-      state *s = this->state;
+      state *s = states[i];
       if (!s->transitions)
         state_transitions_set (s, 0, 0);
       if (!s->reductions)
         state_reductions_set (s, 0, 0);
-
-      states[s->number] = s;
-
-      first_state = this->next;
-      free (this);
     }
-  first_state = NULL;
-  last_state = NULL;
 }
 
 
@@ -397,28 +650,13 @@ generate_states (void)
   item_number initial_core = 0;
   state_list_append (0, 1, &initial_core);
 
-  /* States are queued when they are created; process them all.  */
-  for (state_list *list = first_state; list; list = list->next)
-    {
-      state *s = list->state;
-      if (trace_flag & trace_automaton)
-        fprintf (stderr, "Processing state %d (reached by %s)\n",
-                 s->number,
-                 symbols[s->accessing_symbol]->tag);
-      /* Set up itemset for the transitions out of this state.  itemset gets a
-         vector of all the items that could be accepted next.  */
-      closure (s->items, s->nitems);
-      /* Record the reductions allowed out of this state.  */
-      save_reductions (s);
-      /* Find the itemsets of the states that shifts/gotos can reach.  */
-      new_itemsets (s);
-      /* Find or create the core structures for those states.  */
-      append_states (s);
-
-      /* Create the shifts structures for the shifts to those states,
-         now that the state numbers transitioning to are known.  */
-      state_transitions_set (s, bitset_count (shift_symbol), shiftset);
-    }
+  /* The traces are meant to be read in order, and bitset statistics
+     are not thread safe.  */
+  if (1 < jobs
+      && !(trace_flag & (trace_automaton | trace_closure | trace_bitsets)))
+    generate_states_parallel (jobs);
+  else
+    generate_states_serial ();
 
   /* discard various storage */
   free_storage ();
@@ -25,12 +25,14 @@
 #include <bitset/stats.h>
 #include <closeout.h>
 #include <configmake.h>
+#include <error.h>
 #include <progname.h>
 #include <quote.h>
 #include <quotearg.h>
 #include <relocatable.h> /* relocate2 */
-#include <timevar.h>
 
+#include "batch.h"
+#include "cache.h"
 #include "complain.h"
 #include "conflicts.h"
 #include "derives.h"
@@ -47,6 +49,7 @@
 #include "print-graph.h"
 #include "print-xml.h"
 #include "print.h"
+#include "profile.h"
 #include "reader.h"
 #include "reduce.h"
 #include "scan-code.h"
@@ -57,72 +60,19 @@
 #include "uniqstr.h"
 
 
-int
-main (int argc, char *argv[])
-{
-#define DEPENDS_ON_LIBINTL 1
-  set_program_name (argv[0]);
-  setlocale (LC_ALL, "");
-  {
-    char *cp = NULL;
-    char const *localedir = relocate2 (LOCALEDIR, &cp);
-    bindtextdomain ("bison", localedir);
-    bindtextdomain ("bison-gnulib", localedir);
-    bindtextdomain ("bison-runtime", localedir);
-    free (cp);
-  }
-  textdomain ("bison");
-
-  {
-    char const *cp = getenv ("LC_CTYPE");
-    if (cp && STREQ (cp, "C"))
-      set_custom_quoting (&quote_quoting_options, "'", "'");
-    else
-      set_quoting_style (&quote_quoting_options, locale_quoting_style);
-  }
-
-  atexit (close_stdout);
-
-  uniqstrs_new ();
-  muscle_init ();
-  complain_init ();
-
-  getargs (argc, argv);
-
-  timevar_enabled = trace_flag & trace_time;
-  timevar_init ();
-  timevar_start (tv_total);
-
-  if (trace_flag & trace_bitsets)
-    bitset_stats_enable ();
-
-  /* Read the input.  Copy some parts of it to FGUARD, FACTION, FTABLE
-     and FATTRS.  In file reader.c.  The other parts are recorded in
-     the grammar; see gram.h.  */
-
-  timevar_push (tv_reader);
-  reader (grammar_file);
-  timevar_pop (tv_reader);
-
-  if (complaint_status == status_complaint)
-    goto finish;
-
-  /* Find useless nonterminals and productions and reduce the grammar. */
-  timevar_push (tv_reduce);
-  reduce_grammar ();
-  timevar_pop (tv_reduce);
-
-  /* Record other info about the grammar.  In files derives and
-     nullable.  */
-  timevar_push (tv_sets);
-  derives_compute ();
-  nullable_compute ();
-  timevar_pop (tv_sets);
+/*------------------------------------------------------------------.
+| Build the automaton, solve its conflicts, and compute the parser |
+| tables.                                                          |
+`------------------------------------------------------------------*/
 
+static void
+automaton_compute (void)
+{
   /* Compute LR(0) parser states.  See state.h for more info.  */
-  timevar_push (tv_lr0);
+  profile_push (tv_lr0);
   generate_states ();
-  timevar_pop (tv_lr0);
+  profile_pop (tv_lr0);
+  profile_count ("lr0_states", nstates);
 
   /* Add lookahead sets to parser states.  Except when LALR(1) is
      requested, split states to eliminate LR(1)-relative
@@ -133,7 +83,7 @@ main (int argc, char *argv[])
      lookahead is not enough to disambiguate the parsing.  In file
      conflicts.  Also resolve s/r conflicts based on precedence
      declarations.  */
-  timevar_push (tv_conflicts);
+  profile_push (tv_conflicts);
   conflicts_solve ();
   if (!muscle_percent_define_flag_if ("lr.keep-unreachable-state"))
     {
@@ -145,16 +95,83 @@ main (int argc, char *argv[])
       free (old_to_new);
     }
   conflicts_print ();
-  timevar_pop (tv_conflicts);
+  profile_pop (tv_conflicts);
 
   /* Compute the parser tables.  */
-  timevar_push (tv_actions);
+  profile_push (tv_actions);
   tables_generate ();
-  timevar_pop (tv_actions);
+  profile_pop (tv_actions);
 
   grammar_rules_useless_report (_("rule useless in parser due to conflicts"));
 
   print_precedence_warnings ();
+}
+
+
+/*----------------------------------------------------------------.
+| Process the grammar file, as specified by the options.  Return |
+| the exit status.                                               |
+`----------------------------------------------------------------*/
+
+static int
+process (void)
+{
+  timevar_enabled = trace_flag & trace_time;
+  timevar_init ();
+  timevar_start (tv_total);
+  profile_init ();
+
+  if (trace_flag & trace_bitsets)
+    bitset_stats_enable ();
+
+  /* Read the input.  Copy some parts of it to FGUARD, FACTION, FTABLE
+     and FATTRS.  In file reader.c.  The other parts are recorded in
+     the grammar; see gram.h.  */
+
+  profile_push (tv_reader);
+  reader (grammar_file);
+  profile_pop (tv_reader);
+
+  if (complaint_status == status_complaint)
+    goto finish;
+
+  /* Find useless nonterminals and productions and reduce the grammar. */
+  profile_push (tv_reduce);
+  reduce_grammar ();
+  profile_pop (tv_reduce);
+  profile_count ("ntokens", ntokens);
+  profile_count ("nvars", nvars);
+  profile_count ("nrules", nrules);
+  profile_count ("nritems", nritems);
+  profile_count ("nuseless_nonterminals", nuseless_nonterminals);
+  profile_count ("nuseless_productions", nuseless_productions);
+
+  /* Record other info about the grammar.  In files derives and
+     nullable.  */
+  profile_push (tv_sets);
+  derives_compute ();
+  nullable_compute ();
+  profile_pop (tv_sets);
+
+  /* With --cache-dir, reuse the tables computed by a previous run on
+     a grammar with the same structure.  */
+  profile_push (tv_cache);
+  bool cached = cache_load ();
+  profile_pop (tv_cache);
+  profile_count ("cached", cached);
+  if (!cached)
+    {
+      int diagnostics = diagnostics_count;
+      automaton_compute ();
+      /* The diagnostics would not be issued when loading the tables.  */
+      if (diagnostics_count == diagnostics)
+        {
+          profile_push (tv_cache);
+          cache_save ();
+          profile_pop (tv_cache);
+        }
+    }
+  profile_count ("nstates", nstates);
 
   /* Whether to generate output files.  */
   bool generate = !(feature_flag & feature_syntax_only);
@@ -167,25 +184,25 @@ main (int argc, char *argv[])
       /* Output the detailed report on the grammar.  */
       if (report_flag)
         {
-          timevar_push (tv_report);
+          profile_push (tv_report);
           print_results ();
-          timevar_pop (tv_report);
+          profile_pop (tv_report);
         }
 
       /* Output the graph.  */
       if (graph_flag)
         {
-          timevar_push (tv_graph);
+          profile_push (tv_graph);
           print_graph ();
-          timevar_pop (tv_graph);
+          profile_pop (tv_graph);
         }
 
       /* Output xml.  */
       if (xml_flag)
         {
-          timevar_push (tv_xml);
+          profile_push (tv_xml);
           print_xml ();
-          timevar_pop (tv_xml);
+          profile_pop (tv_xml);
         }
     }
 
@@ -195,21 +212,24 @@ main (int argc, char *argv[])
     goto finish;
 
   /* Lookahead tokens are no longer needed. */
-  timevar_push (tv_free);
-  lalr_free ();
-  timevar_pop (tv_free);
+  if (!cached)
+    {
+      profile_push (tv_free);
+      lalr_free ();
+      profile_pop (tv_free);
+    }
 
   /* Output the tables and the parser to ftable.  In file output.  */
   if (generate)
     {
-      timevar_push (tv_parser);
+      profile_push (tv_parser);
       output ();
-      timevar_pop (tv_parser);
+      profile_pop (tv_parser);
     }
 
  finish:
 
-  timevar_push (tv_free);
+  profile_push (tv_free);
   nullable_free ();
   derives_free ();
   tables_free ();
@@ -225,7 +245,7 @@ main (int argc, char *argv[])
   muscle_free ();
   code_scanner_free ();
   skel_scanner_free ();
-  timevar_pop (tv_free);
+  profile_pop (tv_free);
 
   if (trace_flag & trace_bitsets)
     bitset_stats_dump (stderr);
@@ -233,6 +253,7 @@ main (int argc, char *argv[])
   /* Stop timing and print the times.  */
   timevar_stop (tv_total);
   timevar_print (stderr);
+  profile_output ();
 
   /* Fix input file now, even if there are errors: that's less
      warnings in the following runs.  */
@@ -252,3 +273,71 @@ main (int argc, char *argv[])
 
   return complaint_status ? EXIT_FAILURE : EXIT_SUCCESS;
 }
+
+
+/*-----------------------------------------------------------------.
+| Run a job of --batch or --server, in a process of its own: from |
+| the state at the end of the startup of Bison, process ARGV.     |
+`-----------------------------------------------------------------*/
+
+static int
+run_job (int argc, char *argv[])
+{
+  /* The options of the batch run itself are not meant for the jobs.
+     Each job runs on a single thread, the jobs run in parallel.  */
+  batch_file = NULL;
+  server_flag = false;
+  jobs = 1;
+  profile_file = NULL;
+  getargs (argc, argv);
+  if (batch_file || server_flag)
+    error (EXIT_FAILURE, 0, _("jobs cannot run %s or %s"),
+           quote ("--batch"), quote_n (1, "--server"));
+  return process ();
+}
+
+
+int
+main (int argc, char *argv[])
+{
+#define DEPENDS_ON_LIBINTL 1
+  set_program_name (argv[0]);
+  setlocale (LC_ALL, "");
+  {
+    char *cp = NULL;
+    char const *localedir = relocate2 (LOCALEDIR, &cp);
+    bindtextdomain ("bison", localedir);
+    bindtextdomain ("bison-gnulib", localedir);
+    bindtextdomain ("bison-runtime", localedir);
+    free (cp);
+  }
+  textdomain ("bison");
+
+  {
+    char const *cp = getenv ("LC_CTYPE");
+    if (cp && STREQ (cp, "C"))
+      set_custom_quoting (&quote_quoting_options, "'", "'");
+    else
+      set_quoting_style (&quote_quoting_options, locale_quoting_style);
+  }
+
+  atexit (close_stdout);
+
+  uniqstrs_new ();
+  muscle_init ();
+  complain_init ();
+
+  getargs (argc, argv);
+
+  if (batch_file || server_flag)
+    {
+      int res = batch_run (run_job);
+      muscle_free ();
+      uniqstrs_free ();
+      complain_free ();
+      quotearg_free ();
+      return res;
+    }
+
+  return process ();
+}
@@ -60,7 +60,11 @@ typedef struct
 {
   char const *key;
   char const *value;
+  /* If nonnull, VALUE == STORAGE, a NUL-terminated string of SIZE
+     bytes (not counting the NUL), in a buffer of CAPACITY bytes.  */
   char *storage;
+  size_t size;
+  size_t capacity;
   muscle_kind kind;
 } muscle_entry;
 
@@ -107,6 +111,8 @@ muscle_entry_new (char const *key)
   res->key = key;
   res->value = NULL;
   res->storage = NULL;
+  res->size = 0;
+  res->capacity = 0;
   if (!hash_insert (muscle_table, res))
     xalloc_die ();
   return res;
@@ -163,13 +169,39 @@ muscle_insert (char const *key, char const *value)
     entry = muscle_entry_new (key);
   entry->value = value;
   entry->storage = NULL;
+  entry->size = 0;
+  entry->capacity = 0;
+}
+
+
+/* Append the SIZE first bytes of STR to the storage of ENTRY.  The
+   storage grows geometrically, so that growing a muscle piece by
+   piece takes a time linear in its final size.  */
+
+static void
+muscle_entry_append (muscle_entry *entry, char const *str, size_t size)
+{
+  if (entry->capacity <= entry->size + size)
+    {
+      size_t capacity = entry->capacity ? entry->capacity : 128;
+      while (capacity <= entry->size + size)
+        capacity *= 2;
+      entry->storage = xrealloc (entry->storage, capacity);
+      entry->capacity = capacity;
+    }
+  memcpy (entry->storage + entry->size, str, size);
+  entry->size += size;
+  entry->storage[entry->size] = '\0';
+  entry->value = entry->storage;
 }
 
 
 /* Append VALUE to the current value of KEY.  If KEY did not already
-   exist, create it.  Use MUSCLE_OBSTACK.  De-allocate the previously
-   associated value.  Copy VALUE and SEPARATOR.  If VALUE does not end
-   with TERMINATOR, append one.  */
+   exist, create it.  Copy VALUE and SEPARATOR.  If VALUE does not end
+   with TERMINATOR, append one.
+
+   The value is grown in place (see muscle_entry_append): the previous
+   value is not copied again, and pointers to it are invalidated.  */
 
 static void
 muscle_grow (const char *key, const char *val,
@@ -178,26 +210,25 @@ muscle_grow (const char *key, const char *val,
   muscle_entry *entry = muscle_lookup (key);
   if (entry)
     {
-      obstack_sgrow (&muscle_obstack, entry->value);
-      obstack_sgrow (&muscle_obstack, separator);
-      free (entry->storage);
+      /* Values installed by muscle_insert are not ours: copy them
+         first.  */
+      if (!entry->storage)
+        muscle_entry_append (entry, entry->value, strlen (entry->value));
+      muscle_entry_append (entry, separator, strlen (separator));
     }
   else
-    entry = muscle_entry_new (key);
-
-  obstack_sgrow (&muscle_obstack, val);
+    {
+      entry = muscle_entry_new (key);
+      muscle_entry_append (entry, "", 0);
+    }
 
   size_t vals = strlen (val);
+  muscle_entry_append (entry, val, vals);
+
   size_t terms = strlen (terminator);
   if (terms <= vals
       && STRNEQ (val + vals - terms, terminator))
-    obstack_sgrow (&muscle_obstack, terminator);
-
-  {
-    char const *new_val = obstack_finish0 (&muscle_obstack);
-    entry->value = entry->storage = xstrdup (new_val);
-    obstack_free (&muscle_obstack, new_val);
-  }
+    muscle_entry_append (entry, terminator, terms);
 }
 
 /*------------------------------------------------------------------.
@@ -21,12 +21,13 @@
 #include <config.h>
 #include "system.h"
 
+#include <error.h>
 #include <filename.h> /* IS_PATH_WITH_DIR */
 #include <get-errno.h>
 #include <path-join.h>
 #include <quotearg.h>
 #include <spawn-pipe.h>
-#include <timevar.h>
+#include <sys/stat.h> /* stat */
 #include <wait-process.h>
 
 #include "complain.h"
@@ -35,6 +36,7 @@
 #include "gram.h"
 #include "muscle-tab.h"
 #include "output.h"
+#include "profile.h"
 #include "reader.h"
 #include "reduce.h"
 #include "scan-code.h"    /* max_left_semantic_context */
@@ -46,17 +48,121 @@ static struct obstack format_obstack;
 
 
 /*-------------------------------------------------------------------.
-| Create a function NAME which associates to the muscle NAME the     |
-| result of formatting the FIRST and then TABLE_DATA[BEGIN..END[ (of |
-| TYPE), and to the muscle NAME_max, the max value of the            |
-| TABLE_DATA.                                                        |
+| The parser tables.  They can be huge, so rather than formatting   |
+| them in muscles, sending them through M4, and then reading them   |
+| back, the muscle NAME is only a placeholder, "@table(NAME@)", that |
+| scan_skel replaces by the contents of the table (see at_table in  |
+| scan-skel.l).                                                      |
+`-------------------------------------------------------------------*/
+
+typedef struct
+{
+  /* The name of the table.  */
+  char const *name;
+  /* FIRST, and then DATA[BEGIN..END[.  */
+  int first;
+  int const *data;
+  int begin;
+  int end;
+} output_table;
+
+/* The registered tables.  */
+enum { output_tables_max = 32 };
+static output_table output_tables[output_tables_max];
+static int output_tables_size = 0;
+
+/* Temporary arrays holding the contents of some tables, to free once
+   the output is complete.  */
+static void *output_tables_storage[output_tables_max];
+static int output_tables_storage_size = 0;
+
+static void
+output_table_register (char const *name, int first,
+                       int const *data, int begin, int end)
+{
+  aver (output_tables_size < output_tables_max);
+  output_table *t = &output_tables[output_tables_size++];
+  t->name = name;
+  t->first = first;
+  t->data = data;
+  t->begin = begin;
+  t->end = end;
+}
+
+/* Free P when the output is complete, since its contents is output
+   only when the skeleton scanner reaches the table.  */
+static void
+output_table_storage (void *p)
+{
+  aver (output_tables_storage_size < output_tables_max);
+  output_tables_storage[output_tables_storage_size++] = p;
+}
+
+static void
+output_tables_free (void)
+{
+  for (int i = 0; i < output_tables_storage_size; ++i)
+    free (output_tables_storage[i]);
+  output_tables_storage_size = 0;
+  output_tables_size = 0;
+}
+
+int
+output_table_contents (FILE *out, char const *name)
+{
+  output_table const *t = NULL;
+  for (int i = 0; i < output_tables_size; ++i)
+    if (STREQ (output_tables[i].name, name))
+      {
+        t = &output_tables[i];
+        break;
+      }
+  if (!t)
+    return -1;
+
+  /* Format by large chunks rather than one fprintf per value.  */
+  enum { chunk_size = 64 * 1024, entry_size_max = 32 };
+  char *buf = xmalloc (chunk_size);
+  int len = sprintf (buf, "%6d", t->first);
+  int lines = 0;
+  int j = 1;
+  for (int i = t->begin; i < t->end; ++i)
+    {
+      if (chunk_size - entry_size_max < len)
+        {
+          fwrite (buf, 1, len, out);
+          len = 0;
+        }
+      buf[len++] = ',';
+      if (j >= 10)
+        {
+          memcpy (buf + len, "\n  ", 3);
+          len += 3;
+          ++lines;
+          j = 1;
+        }
+      else
+        ++j;
+      len += sprintf (buf + len, "%6d", t->data[i]);
+    }
+  fwrite (buf, 1, len, out);
+  free (buf);
+  return lines;
+}
+
+
+/*-------------------------------------------------------------------.
+| Create a function NAME which associates to the muscle NAME a      |
+| placeholder for the result of formatting the FIRST and then       |
+| TABLE_DATA[BEGIN..END[ (of TYPE), and to the muscle NAME_max, the |
+| max value of the TABLE_DATA.  TABLE_DATA must remain valid until  |
+| the skeleton is processed.                                         |
 |                                                                    |
 | For the typical case of outputting a complete table from 0, pass   |
 | TABLE[0] as FIRST, and 1 as BEGIN.  For instance                   |
 | muscle_insert_base_table ("pact", base, base[0], 1, nstates);      |
 `-------------------------------------------------------------------*/
 
-
 #define GENERATE_MUSCLE_INSERT_TABLE(Name, Type)                        \
                                                                         \
 static void                                                             \
@@ -65,25 +171,15 @@ Name (char const *name, Type *table_data, Type first,                   \
 {                                                                       \
   Type min = first;                                                     \
   Type max = first;                                                     \
-  int j = 1;                                                            \
-                                                                        \
-  obstack_printf (&format_obstack, "%6d", first);                       \
   for (int i = begin; i < end; ++i)                                     \
     {                                                                   \
-      obstack_1grow (&format_obstack, ',');                             \
-      if (j >= 10)                                                      \
-        {                                                               \
-          obstack_sgrow (&format_obstack, "\n  ");                      \
-          j = 1;                                                        \
-        }                                                               \
-      else                                                              \
-        ++j;                                                            \
-      obstack_printf (&format_obstack, "%6d", table_data[i]);           \
       if (table_data[i] < min)                                          \
         min = table_data[i];                                            \
       if (max < table_data[i])                                          \
         max = table_data[i];                                            \
     }                                                                   \
+  output_table_register (name, first, table_data, begin, end);          \
+  obstack_printf (&format_obstack, "@table(%s@)", name);                \
   muscle_insert (name, obstack_finish0 (&format_obstack));              \
                                                                         \
   long lmin = min;                                                      \
@@ -282,7 +378,7 @@ prepare_symbols (void)
           values[i] = symbols[i]->translatable;
         muscle_insert_int_table ("translatable", values,
                                  values[0], 1, ntokens);
-        free (values);
+        output_table_storage (values);
       }
   }
 
@@ -293,7 +389,7 @@ prepare_symbols (void)
       values[i] = symbols[i]->content->user_token_number;
     muscle_insert_int_table ("toknum", values,
                              values[0], 1, ntokens);
-    free (values);
+    output_table_storage (values);
   }
 }
 
@@ -354,14 +450,14 @@ prepare_rules (void)
   MUSCLE_INSERT_INT ("rules_number", nrules);
   MUSCLE_INSERT_INT ("max_left_semantic_context", max_left_semantic_context);
 
-  free (prhs);
-  free (rhs);
-  free (rline);
-  free (r1);
-  free (r2);
-  free (dprec);
-  free (merger);
-  free (immediate);
+  output_table_storage (prhs);
+  output_table_storage (rhs);
+  output_table_storage (rline);
+  output_table_storage (r1);
+  output_table_storage (r2);
+  output_table_storage (dprec);
+  output_table_storage (merger);
+  output_table_storage (immediate);
 }
 
 /*--------------------------------------------.
@@ -371,15 +467,11 @@ prepare_rules (void)
 static void
 prepare_states (void)
 {
-  symbol_number *values = xnmalloc (nstates, sizeof *values);
-  for (state_number i = 0; i < nstates; ++i)
-    values[i] = states[i]->accessing_symbol;
-  muscle_insert_symbol_number_table ("stos", values,
+  muscle_insert_symbol_number_table ("stos", yystos,
                                      0, 1, nstates);
-  free (values);
 
   MUSCLE_INSERT_INT ("last", high);
-  MUSCLE_INSERT_INT ("final_state_number", final_state->number);
+  MUSCLE_INSERT_INT ("final_state_number", yyfinal);
   MUSCLE_INSERT_INT ("states_number", nstates);
 }
 
@@ -626,6 +718,19 @@ prepare_actions (void)
   muscle_insert_base_table ("check", check,
                             check[0], 1, high + 1);
 
+  /* Output ACTION and ACTROW, for %define api.table.encoding dense
+     and two-level.  */
+  if (tables_encoding != table_encoding_packed)
+    {
+      int nrows = (tables_encoding == table_encoding_dense
+                   ? state_number_as_int (nstates) : nactrows);
+      muscle_insert_base_table ("action", yyaction,
+                                yyaction[0], 1, nrows * ntokens);
+      if (tables_encoding == table_encoding_two_level)
+        muscle_insert_int_table ("actrow", yyactrow,
+                                 yyactrow[0], 1, nstates);
+    }
+
   /* GLR parsing slightly modifies YYTABLE and YYCHECK (and thus
      YYPACT) so that in states with unresolved conflicts, the default
      reduction is not used in the conflicted entries, so that there is
@@ -662,6 +767,22 @@ muscles_output (FILE *out)
 | Call the skeleton parser.  |
 `---------------------------*/
 
+/* Whether FROZEN, a frozen state of M4SUGAR, can be loaded instead of
+   M4SUGAR by M4: it must be up to date, and M4 must be the m4 that
+   created it at build time (frozen files depend on the version of
+   m4).  */
+static bool
+m4_frozen_state_usable (char const *m4, char const *m4sugar,
+                        char const *frozen)
+{
+  struct stat src;
+  struct stat dst;
+  return (STREQ (m4, M4)
+          && stat (frozen, &dst) == 0
+          && stat (m4sugar, &src) == 0
+          && src.st_mtime <= dst.st_mtime);
+}
+
 static void
 output_skeleton (void)
 {
@@ -670,6 +791,12 @@ output_skeleton (void)
   char const *datadir = pkgdatadir ();
   char *skeldir = xpath_join (datadir, "skeletons");
   char *m4sugar = xpath_join (datadir, "m4sugar/m4sugar.m4");
+  /* A frozen state of m4sugar.m4, built when Bison is built.
+     Reloading it is much faster than reading m4sugar.m4.  bison.m4
+     and the skeletons cannot be frozen: they use the muscles, which
+     are read before them.  */
+  char *m4sugar_frozen = xpath_join (datadir, "m4sugar/m4sugar.m4f");
+  bool frozen = m4_frozen_state_usable (m4, m4sugar, m4sugar_frozen);
   char *m4bison = xpath_join (skeldir, "bison.m4");
   char *skel = (IS_PATH_WITH_DIR (skeleton)
                 ? xstrdup (skeleton)
@@ -683,8 +810,9 @@ output_skeleton (void)
   /* Create an m4 subprocess connected to us via two pipes.  */
 
   if (trace_flag & trace_tools)
-    fprintf (stderr, "running: %s %s - %s %s\n",
-             m4, m4sugar, m4bison, skel);
+    fprintf (stderr, "running: %s %s%s - %s %s\n",
+             m4, frozen ? "-R " : "", frozen ? m4sugar_frozen : m4sugar,
+             m4bison, skel);
 
   /* Some future version of GNU M4 (most likely 1.6) may treat the -dV in a
      position-dependent manner.  Keep it as the first argument so that all
@@ -696,7 +824,7 @@ output_skeleton (void)
   int filter_fd[2];
   pid_t pid;
   {
-    char const *argv[10];
+    char const *argv[12];
     int i = 0;
     argv[i++] = m4;
 
@@ -716,7 +844,13 @@ output_skeleton (void)
     argv[i++] = datadir;
     if (trace_flag & trace_m4)
       argv[i++] = "-dV";
-    argv[i++] = m4sugar;
+    if (frozen)
+      {
+        argv[i++] = "-R";
+        argv[i++] = m4sugar_frozen;
+      }
+    else
+      argv[i++] = m4sugar;
     argv[i++] = "-";
     argv[i++] = m4bison;
     argv[i++] = skel;
@@ -730,6 +864,7 @@ output_skeleton (void)
 
   free (skeldir);
   free (m4sugar);
+  free (m4sugar_frozen);
   free (m4bison);
   free (skel);
 
@@ -737,12 +872,30 @@ output_skeleton (void)
     muscles_output (stderr);
   {
     FILE *out = xfdopen (filter_fd[1], "w");
-    muscles_output (out);
+    if (profile_file)
+      {
+        /* A pipe has no position: measure the size of m4's input in
+           a temporary file.  */
+        FILE *tmp = tmpfile ();
+        if (!tmp)
+          error (EXIT_FAILURE, get_errno (),
+                 _("cannot create temporary file"));
+        muscles_output (tmp);
+        profile_count ("m4_input_bytes", ftell (tmp));
+        rewind (tmp);
+        char buf[BUFSIZ];
+        size_t n;
+        while ((n = fread (buf, 1, sizeof buf, tmp)))
+          fwrite (buf, 1, n, out);
+        xfclose (tmp);
+      }
+    else
+      muscles_output (out);
     xfclose (out);
   }
 
   /* Read and process m4's output.  */
-  timevar_push (tv_m4);
+  profile_push (tv_m4);
   {
     FILE *in = xfdopen (filter_fd[0], "r");
     scan_skel (in);
@@ -753,7 +906,7 @@ output_skeleton (void)
     xfclose (in);
   }
   wait_subprocess (pid, "m4", false, false, true, true, NULL);
-  timevar_pop (tv_m4);
+  profile_pop (tv_m4);
 }
 
 static void
@@ -836,5 +989,6 @@ output (void)
   if (complaint_status)
     unlink_generated_sources ();
 
+  output_tables_free ();
   obstack_free (&format_obstack, NULL);
 }
@@ -24,4 +24,9 @@
 /* Output the parsing tables and the parser code to FTABLE.  */
 void output (void);
 
+/* Output to OUT the contents of the parser table NAME, for the
+   "@table(NAME@)" skeleton directive.  Return the number of lines
+   output, or -1 if there is no such table.  */
+int output_table_contents (FILE *out, char const *name);
+
 #endif /* !OUTPUT_H_ */
@@ -176,7 +176,7 @@ print_state (state *s, FILE *fgraph)
 void
 print_graph (void)
 {
-  FILE *fgraph = xfopen (spec_graph_file, "w");
+  FILE *fgraph = xfopen_output (spec_graph_file);
   start_graph (fgraph);
 
   /* Output nodes and edges. */
@@ -184,5 +184,5 @@ print_graph (void)
     print_state (states[i], fgraph);
 
   finish_graph (fgraph);
-  xfclose (fgraph);
+  xfclose_output (fgraph);
 }
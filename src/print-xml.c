@@ -487,7 +487,7 @@ xml_escape (char const *str)
 void
 print_xml (void)
 {
-  FILE *out = xfopen (spec_xml_file, "w");
+  FILE *out = xfopen_output (spec_xml_file);
 
   fputs ("<?xml version=\"1.0\"?>\n\n", out);
 
@@ -522,5 +522,5 @@ print_xml (void)
   for (int i = 0; i < num_escape_bufs; ++i)
     free (escape_bufs[i].ptr);
 
-  xfclose (out);
+  xfclose_output (out);
 }
@@ -440,7 +440,7 @@ print_results (void)
 {
   /* We used to use just .out if SPEC_NAME_PREFIX (-p) was used, but
      that conflicts with Posix.  */
-  FILE *out = xfopen (spec_verbose_file, "w");
+  FILE *out = xfopen_output (spec_verbose_file);
 
   reduce_output (out);
   grammar_rules_partial_print (out,
@@ -458,5 +458,11 @@ print_results (void)
     print_state (out, states[i]);
   bitset_free (no_reduce_set);
 
-  xfclose (out);
+  if (report_flag & report_tables)
+    {
+      fputc ('\n', out);
+      tables_print_sizes (out);
+    }
+
+  xfclose_output (out);
 }
@@ -0,0 +1,302 @@
+/* Machine-readable profile of a run of Bison.
+
+   Copyright (C) 2020 Free Software Foundation, Inc.
+
+   This file is part of Bison, the GNU Compiler Compiler.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <config.h>
+#include "system.h"
+
+#include <gethrxtime.h>
+#include <sys/resource.h>
+#include <xtime.h>
+#if HAVE_MALLINFO2
+# include <malloc.h>
+#endif
+
+#include "files.h"
+#include "getargs.h"
+#include "profile.h"
+
+/* The identifiers and names of the phases.  */
+static char const *const profile_ids[] =
+{
+#define DEFTIMEVAR(Id, Name) #Id,
+#include "timevar.def"
+#undef DEFTIMEVAR
+};
+
+static char const *const profile_names[] =
+{
+#define DEFTIMEVAR(Id, Name) Name,
+#include "timevar.def"
+#undef DEFTIMEVAR
+};
+
+/* The resources used by the process at some point.  */
+typedef struct
+{
+  xtime_t wall;
+  xtime_t user;
+  xtime_t sys;
+  /* Peak resident set size, in kilobytes.  */
+  long max_rss;
+  /* Memory allocated with malloc and not released yet, in bytes, or
+     -1 if unknown.  */
+  long heap;
+} profile_sample;
+
+/* The resources used by a phase.  */
+typedef struct
+{
+  /* Number of times the phase was entered.  */
+  int calls;
+  xtime_t wall;
+  xtime_t user;
+  xtime_t sys;
+  /* The largest values observed when leaving or interrupting the
+     phase.  */
+  long max_rss;
+  long heap;
+} profile_phase;
+
+static profile_phase profile_phases[TIMEVAR_LAST];
+
+/* The stack of the current phases.  */
+enum { profile_stack_max = 2 * TIMEVAR_LAST };
+static timevar_id_t profile_stack[profile_stack_max];
+static int profile_depth;
+
+/* When profile_init was called, and when the current phase was last
+   charged.  */
+static profile_sample profile_start;
+static profile_sample profile_last;
+
+/* The recorded sizes, in the order of their first definition.  */
+typedef struct
+{
+  char const *name;
+  long value;
+} profile_counter;
+
+enum { profile_counters_max = 64 };
+static profile_counter profile_counters[profile_counters_max];
+static int profile_ncounters;
+
+
+static void
+profile_now (profile_sample *res)
+{
+  /* Include m4, as --trace=time does.  */
+  struct rusage self;
+  getrusage (RUSAGE_SELF, &self);
+  struct rusage children;
+  getrusage (RUSAGE_CHILDREN, &children);
+
+  res->wall = gethrxtime ();
+  res->user
+    = xtime_make (self.ru_utime.tv_sec + children.ru_utime.tv_sec,
+                  (self.ru_utime.tv_usec + children.ru_utime.tv_usec) * 1000);
+  res->sys
+    = xtime_make (self.ru_stime.tv_sec + children.ru_stime.tv_sec,
+                  (self.ru_stime.tv_usec + children.ru_stime.tv_usec) * 1000);
+  res->max_rss = self.ru_maxrss;
+#if HAVE_MALLINFO2
+  struct mallinfo2 info = mallinfo2 ();
+  res->heap = (long) (info.uordblks + info.hblkhd);
+#else
+  res->heap = -1;
+#endif
+}
+
+/* Charge the resources used since the last call to the current
+   phase.  */
+static void
+profile_charge (void)
+{
+  profile_sample now;
+  profile_now (&now);
+  if (profile_depth)
+    {
+      profile_phase *p = &profile_phases[profile_stack[profile_depth - 1]];
+      p->wall += now.wall - profile_last.wall;
+      p->user += now.user - profile_last.user;
+      p->sys += now.sys - profile_last.sys;
+      if (p->max_rss < now.max_rss)
+        p->max_rss = now.max_rss;
+      if (p->heap < now.heap)
+        p->heap = now.heap;
+    }
+  profile_last = now;
+}
+
+
+void
+profile_init (void)
+{
+  profile_depth = 0;
+  profile_ncounters = 0;
+  memset (profile_phases, 0, sizeof profile_phases);
+  if (profile_file)
+    {
+      profile_now (&profile_start);
+      profile_last = profile_start;
+    }
+}
+
+void
+profile_push (timevar_id_t tv)
+{
+  timevar_push (tv);
+  if (profile_file)
+    {
+      profile_charge ();
+      aver (profile_depth < profile_stack_max);
+      profile_stack[profile_depth++] = tv;
+      profile_phases[tv].calls += 1;
+    }
+}
+
+void
+profile_pop (timevar_id_t tv)
+{
+  timevar_pop (tv);
+  if (profile_file)
+    {
+      profile_charge ();
+      aver (profile_depth && profile_stack[profile_depth - 1] == tv);
+      --profile_depth;
+    }
+}
+
+void
+profile_count (char const *name, long value)
+{
+  if (!profile_file)
+    return;
+  int i = 0;
+  while (i < profile_ncounters && !STREQ (profile_counters[i].name, name))
+    ++i;
+  if (i == profile_ncounters)
+    {
+      aver (profile_ncounters < profile_counters_max);
+      profile_counters[profile_ncounters++].name = name;
+    }
+  profile_counters[i].value = value;
+}
+
+
+/*-----------------------------.
+| Output the profile in JSON.  |
+`-----------------------------*/
+
+static void
+json_string (FILE *out, char const *s)
+{
+  putc ('"', out);
+  for (; *s; ++s)
+    switch (*s)
+      {
+      case '"':  fputs ("\\\"", out); break;
+      case '\\': fputs ("\\\\", out); break;
+      case '\n': fputs ("\\n", out);  break;
+      case '\t': fputs ("\\t", out);  break;
+      default:
+        if ((unsigned char) *s < 0x20)
+          fprintf (out, "\\u%04x", (unsigned char) *s);
+        else
+          putc (*s, out);
+      }
+  putc ('"', out);
+}
+
+/* Output in seconds.  */
+static void
+json_time (FILE *out, char const *key, xtime_t t)
+{
+  fprintf (out, "\"%s\": %.6f", key, (double) t / XTIME_PRECISION);
+}
+
+static void
+json_resources (FILE *out, xtime_t wall, xtime_t user, xtime_t sys,
+                long max_rss, long heap)
+{
+  json_time (out, "wall", wall);
+  fputs (", ", out);
+  json_time (out, "user", user);
+  fputs (", ", out);
+  json_time (out, "sys", sys);
+  fprintf (out, ", \"max_rss\": %ld", max_rss);
+  if (0 <= heap)
+    fprintf (out, ", \"heap\": %ld", heap);
+}
+
+void
+profile_output (void)
+{
+  if (!profile_file)
+    return;
+
+  profile_sample end;
+  profile_now (&end);
+
+  FILE *out = xfopen (profile_file, "w");
+  fputs ("{\n", out);
+  fputs ("  \"version\": ", out);
+  json_string (out, VERSION);
+  fputs (",\n  \"grammar\": ", out);
+  json_string (out, grammar_file ? grammar_file : "");
+  fputs (",\n  \"total\": { ", out);
+  json_resources (out,
+                  end.wall - profile_start.wall,
+                  end.user - profile_start.user,
+                  end.sys - profile_start.sys,
+                  end.max_rss, end.heap);
+  fputs (" },\n", out);
+
+  fputs ("  \"phases\": [", out);
+  char const *sep = "\n";
+  for (int i = 0; i < TIMEVAR_LAST; ++i)
+    if (profile_phases[i].calls)
+      {
+        profile_phase const *p = &profile_phases[i];
+        fputs (sep, out);
+        sep = ",\n";
+        fputs ("    { \"id\": ", out);
+        /* Skip the "tv_" prefix.  */
+        json_string (out, profile_ids[i] + 3);
+        fputs (", \"name\": ", out);
+        json_string (out, profile_names[i]);
+        fprintf (out, ", \"calls\": %d, ", p->calls);
+        json_resources (out, p->wall, p->user, p->sys, p->max_rss, p->heap);
+        fputs (" }", out);
+      }
+  fputs ("\n  ],\n", out);
+
+  fputs ("  \"counts\": {", out);
+  sep = "\n";
+  for (int i = 0; i < profile_ncounters; ++i)
+    {
+      fputs (sep, out);
+      sep = ",\n";
+      fputs ("    ", out);
+      json_string (out, profile_counters[i].name);
+      fprintf (out, ": %ld", profile_counters[i].value);
+    }
+  fputs ("\n  }\n", out);
+  fputs ("}\n", out);
+  xfclose (out);
+}
@@ -0,0 +1,48 @@
+/* Machine-readable profile of a run of Bison.
+
+   Copyright (C) 2020 Free Software Foundation, Inc.
+
+   This file is part of Bison, the GNU Compiler Compiler.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifndef PROFILE_H_
+# define PROFILE_H_
+
+# include <timevar.h>
+
+/* The phases of Bison are the timing variables of timevar.def.  Both
+   --trace=time and --profile are fed by profile_push and
+   profile_pop, which are to be used instead of timevar_push and
+   timevar_pop.  As with timevar, the time spent in a nested phase is
+   not counted in the enclosing one.  */
+
+/* Start profiling, if --profile was given.  */
+void profile_init (void);
+
+/* Enter the phase TV.  */
+void profile_push (timevar_id_t tv);
+
+/* Leave the phase TV.  */
+void profile_pop (timevar_id_t tv);
+
+/* Record that the size NAME (e.g., "nstates", a string that must
+   outlive the run) is VALUE.  A later call for the same NAME
+   overrides the value.  */
+void profile_count (char const *name, long value);
+
+/* Write the profile into the file given to --profile, if any.  */
+void profile_output (void);
+
+#endif /* !PROFILE_H_ */
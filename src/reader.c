@@ -735,6 +735,8 @@ prepare_percent_define_front_end_variables (void)
       muscle_percent_define_default ("lr.default-reduction", "accepting");
     free (lr_type);
   }
+  muscle_percent_define_default ("api.table.encoding", "packed");
+  muscle_percent_define_default ("lr.lookahead-sets", "auto");
 
   /* Check %define front-end variables.  */
   {
@@ -742,6 +744,8 @@ prepare_percent_define_front_end_variables (void)
       {
        "lr.type", "lr""(0)", "lalr", "ielr", "canonical-lr", NULL,
        "lr.default-reduction", "most", "consistent", "accepting", NULL,
+       "api.table.encoding", "packed", "dense", "two-level", NULL,
+       "lr.lookahead-sets", "auto", "dense", "sparse", NULL,
        NULL
       };
     muscle_percent_define_check_values (values);
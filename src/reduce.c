@@ -55,29 +55,104 @@ static bitset V1;
 int nuseless_productions;
 int nuseless_nonterminals;
 
-#define bitset_swap(Lhs, Rhs)                   \
-  do {                                          \
-    bitset lhs__ = Lhs;                         \
-    Lhs = Rhs;                                  \
-    Rhs = lhs__;                                \
-  } while (0)
+/* For each nonterminal, the rules where it occurs.  The rules of
+   nonterminal I + NTOKENS are RULES[START[I]] to RULES[START[I + 1] -
+   1].  */
+typedef struct
+{
+  int *start;
+  rule_number *rules;
+} nterm_rules;
 
-/*-------------------------------------------------------------------.
-| Another way to do this would be with a set for each production and |
-| then do subset tests against N0, but even for the C grammar the    |
-| whole reducing process takes only 2 seconds on my 8Mhz AT.         |
-`-------------------------------------------------------------------*/
+/* The rules of each nonterminal as LHS.  */
+static nterm_rules lhs_rules;
+
+/* The rules of each nonterminal in the RHS, once per occurrence.  */
+static nterm_rules rhs_rules;
+
+/*---------------------------------------------------------------.
+| Add to RES (which is being built) the occurrence of the        |
+| nonterminal SYM in rule R.  During the first pass, count the   |
+| occurrences in RES->START[SYM - NTOKENS + 1].  During the      |
+| second pass, RES->START[SYM - NTOKENS] is the next free slot.  |
+`---------------------------------------------------------------*/
+
+static void
+nterm_rules_add (nterm_rules *res, int pass,
+                 symbol_number sym, rule_number r)
+{
+  if (pass == 0)
+    res->start[sym - ntokens + 1] += 1;
+  else
+    res->rules[res->start[sym - ntokens]++] = r;
+}
+
+/* Build LHS_RULES and RHS_RULES.  */
+static void
+nterm_rules_init (void)
+{
+  nterm_rules *indexes[] = { &lhs_rules, &rhs_rules };
+  for (int k = 0; k < 2; ++k)
+    indexes[k]->start = xcalloc (nvars + 1, sizeof *indexes[k]->start);
+
+  for (int pass = 0; pass < 2; ++pass)
+    {
+      for (rule_number r = 0; r < nrules; ++r)
+        {
+          nterm_rules_add (&lhs_rules, pass, rules[r].lhs->number, r);
+          for (item_number *rhsp = rules[r].rhs; 0 <= *rhsp; ++rhsp)
+            if (ISVAR (*rhsp))
+              nterm_rules_add (&rhs_rules, pass, *rhsp, r);
+        }
+
+      for (int k = 0; k < 2; ++k)
+        {
+          int *start = indexes[k]->start;
+          if (pass == 0)
+            {
+              /* Turn the counts into the first slots.  */
+              for (symbol_number i = 0; i < nvars; ++i)
+                start[i + 1] += start[i];
+              indexes[k]->rules
+                = xnmalloc (start[nvars] + 1, sizeof *indexes[k]->rules);
+            }
+          else
+            {
+              /* Each START[I] is now the end of the slots of I.  */
+              for (symbol_number i = nvars; 0 < i; --i)
+                start[i] = start[i - 1];
+              start[0] = 0;
+            }
+        }
+    }
+}
 
-static bool
-useful_production (rule_number r, bitset N0)
+static void
+nterm_rules_free (void)
 {
-  /* A production is useful if all of the nonterminals in its appear
-     in the set of useful nonterminals.  */
+  free (lhs_rules.start);
+  free (lhs_rules.rules);
+  free (rhs_rules.start);
+  free (rhs_rules.rules);
+}
+
 
-  for (item_number *rhsp = rules[r].rhs; 0 <= *rhsp; ++rhsp)
-    if (ISVAR (*rhsp) && !bitset_test (N0, *rhsp - ntokens))
-      return false;
-  return true;
+/*-----------------------------------------------------------------.
+| Rule R has no useless nonterminals in its RHS: add it to P, and  |
+| its LHS to N.  If the LHS is new, append it to the queue ending  |
+| at *TAILP.                                                       |
+`-----------------------------------------------------------------*/
+
+static void
+useful_production (rule_number r, symbol_number **tailp)
+{
+  bitset_set (P, r);
+  symbol_number lhs = rules[r].lhs->number;
+  if (!bitset_test (N, lhs - ntokens))
+    {
+      bitset_set (N, lhs - ntokens);
+      *(*tailp)++ = lhs;
+    }
 }
 
 
@@ -90,43 +165,43 @@ useful_production (rule_number r, bitset N0)
 static void
 useless_nonterminals (void)
 {
-  /* N is set as built.  Np is set being built this iteration. P is
-     set of all productions which have a RHS all in N.  */
-
-  bitset Np = bitset_create (nvars, BITSET_FIXED);
-
-  /* The set being computed is a set of nonterminals which can derive
-     the empty string or strings consisting of all terminals. At each
-     iteration a nonterminal is added to the set if there is a
-     production with that nonterminal as its LHS for which all the
-     nonterminals in its RHS are already in the set.  Iterate until
-     the set being computed remains unchanged.  Any nonterminals not
-     in the set at that point are useless in that they will never be
+  /* N is the set of nonterminals which can derive strings consisting
+     of only terminals (possibly empty).  A nonterminal is in N if
+     there is a production with that nonterminal as its LHS for which
+     all the nonterminals in its RHS are already in N.  Any
+     nonterminals not in N are useless in that they will never be
      used in deriving a sentence of the language.
 
-     This iteration doesn't use any special traversal over the
-     productions.  A set is kept of all productions for which all the
-     nonterminals in the RHS are in useful.  Only productions not in
-     this set are scanned on each iteration.  At the end, this set is
-     saved to be used when finding useful productions: only
+     As in nullable_compute, use a worklist: COUNT[R] is the number
+     of occurrences of nonterminals in the RHS of R that are not in N
+     yet.  When it drops to 0, R is useful.  Each nonterminal enters
+     the queue once, when it is added to N, and then decrements the
+     count of the rules where it occurs, so each rule is visited once
+     per occurrence of a nonterminal in its RHS.
+
+     P is the set of all productions which have a RHS all in N.  Only
      productions in this set will appear in the final grammar.  */
+  int *count = xcalloc (nrules, sizeof *count);
+  symbol_number *queue = xnmalloc (nvars, sizeof *queue);
+  symbol_number *head = queue;
+  symbol_number *tail = queue;
+
+  for (int j = 0; j < rhs_rules.start[nvars]; ++j)
+    count[rhs_rules.rules[j]] += 1;
+  for (rule_number r = 0; r < nrules; ++r)
+    if (!count[r])
+      useful_production (r, &tail);
 
-  while (1)
+  while (head < tail)
     {
-      bitset_copy (Np, N);
-      for (rule_number r = 0; r < nrules; ++r)
-        if (!bitset_test (P, r)
-            && useful_production (r, N))
-          {
-            bitset_set (Np, rules[r].lhs->number - ntokens);
-            bitset_set (P, r);
-          }
-      if (bitset_equal_p (N, Np))
-        break;
-      bitset_swap (N, Np);
+      symbol_number i = *head++ - ntokens;
+      for (int j = rhs_rules.start[i]; j < rhs_rules.start[i + 1]; ++j)
+        if (--count[rhs_rules.rules[j]] == 0)
+          useful_production (rhs_rules.rules[j], &tail);
     }
-  bitset_free (N);
-  N = Np;
+
+  free (queue);
+  free (count);
 }
 
 
@@ -135,12 +210,12 @@ inaccessable_symbols (void)
 {
   /* Find out which productions are reachable and which symbols are
      used.  Starting with an empty set of productions and a set of
-     symbols which only has the start symbol in it, iterate over all
-     productions until the set of productions remains unchanged for an
-     iteration.  For each production which has a LHS in the set of
-     reachable symbols, add the production to the set of reachable
-     productions, and add all of the nonterminals in the RHS of the
-     production to the set of reachable symbols.
+     symbols which only has the start symbol in it, for each
+     production which has a LHS in the set of reachable symbols, add
+     the production to the set of reachable productions, and add all
+     of the symbols in the RHS of the production to the set of
+     reachable symbols.  Use a worklist of the reachable nonterminals,
+     so that each production is visited once.
 
      Consider only the (partially) reduced grammar which has only
      nonterminals in N and productions in P.
@@ -156,36 +231,41 @@ inaccessable_symbols (void)
      terminals are printed (if running in verbose mode) so that the
      user can know.  */
 
-  bitset Vp = bitset_create (nsyms, BITSET_FIXED);
   bitset Pp = bitset_create (nrules, BITSET_FIXED);
 
   /* If the start symbol isn't useful, then nothing will be useful. */
   if (bitset_test (N, accept->content->number - ntokens))
     {
+      symbol_number *queue = xnmalloc (nvars, sizeof *queue);
+      symbol_number *head = queue;
+      symbol_number *tail = queue;
       bitset_set (V, accept->content->number);
+      *tail++ = accept->content->number;
 
-      while (1)
+      while (head < tail)
         {
-          bitset_copy (Vp, V);
-          for (rule_number r = 0; r < nrules; ++r)
-            if (!bitset_test (Pp, r)
-                && bitset_test (P, r)
-                && bitset_test (V, rules[r].lhs->number))
-              {
-                for (item_number *rhsp = rules[r].rhs; 0 <= *rhsp; ++rhsp)
-                  if (ISTOKEN (*rhsp) || bitset_test (N, *rhsp - ntokens))
-                    bitset_set (Vp, *rhsp);
-                bitset_set (Pp, r);
-              }
-          if (bitset_equal_p (V, Vp))
-            break;
-          bitset_swap (V, Vp);
+          symbol_number i = *head++ - ntokens;
+          for (int j = lhs_rules.start[i]; j < lhs_rules.start[i + 1]; ++j)
+            {
+              rule_number r = lhs_rules.rules[j];
+              if (bitset_test (P, r))
+                {
+                  bitset_set (Pp, r);
+                  for (item_number *rhsp = rules[r].rhs; 0 <= *rhsp; ++rhsp)
+                    if (ISTOKEN (*rhsp))
+                      bitset_set (V, *rhsp);
+                    else if (bitset_test (N, *rhsp - ntokens)
+                             && !bitset_test (V, *rhsp))
+                      {
+                        bitset_set (V, *rhsp);
+                        *tail++ = *rhsp;
+                      }
+                }
+            }
         }
+      free (queue);
     }
 
-  bitset_free (V);
-  V = Vp;
-
   /* These tokens (numbered 0, 1, and 2) are internal to Bison.
      Consider them useful. */
   bitset_set (V, endtoken->content->number);   /* end-of-input token */
@@ -373,8 +453,10 @@ reduce_grammar (void)
   V = bitset_create (nsyms, BITSET_FIXED);
   V1 = bitset_create (nsyms, BITSET_FIXED);
 
+  nterm_rules_init ();
   useless_nonterminals ();
   inaccessable_symbols ();
+  nterm_rules_free ();
 
   /* Did we reduce something? */
   if (nuseless_nonterminals || nuseless_productions)
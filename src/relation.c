@@ -22,6 +22,7 @@
 #include "system.h"
 
 #include <bitsetv.h>
+#include <glthread/thread.h>
 
 #include "getargs.h"
 #include "relation.h"
@@ -56,71 +57,307 @@ relation_print (const char *title,
 }
 
 
-/*---------------------------------------------------------------.
-| digraph & traverse.                                            |
-|                                                                |
-| The following variables are used as common storage between the |
-| two.                                                           |
-`---------------------------------------------------------------*/
-
-static relation R;
-static relation_nodes indexes;
-static relation_nodes vertices;
-static relation_node top;
-static relation_node infinity;
-static bitsetv F;
-
+/*-------------------------------------------------------------------.
+| digraph.                                                          |
+|                                                                   |
+| DeRemer and Pennello's algorithm is a variation of Tarjan's       |
+| algorithm to compute the strongly connected components (SCCs) of  |
+| R: all the nodes of an SCC have the same final FUNCTION.          |
+|                                                                   |
+| We first compute the SCCs with an explicit stack (deep relations, |
+| such as long chains of INCLUDES, would exhaust the C stack        |
+| otherwise).  Tarjan's algorithm produces the SCCs in reverse      |
+| topological order: an SCC is produced after all the SCCs it       |
+| reaches.  Then we compute FUNCTION once per SCC, on its root,     |
+| from the members of the SCC, and the roots of its successors in   |
+| the condensed graph (where each successor appears once), and      |
+| finally copy it to the other members.                             |
+`-------------------------------------------------------------------*/
+
+/* The condensation of a relation: its strongly connected
+   components.  */
+typedef struct
+{
+  /* Number of SCCs.  */
+  relation_node ncomps;
+  /* The members of SCC C are MEMBERS[START[C]] to
+     MEMBERS[START[C+1]-1].  The last one is its root.  */
+  relation_node *start;
+  relation_node *members;
+  /* The successors of SCC C in the condensed graph, without
+     duplicates, are SUCCS[SUCCS_START[C]] to
+     SUCCS[SUCCS_START[C+1]-1].  */
+  relation_node *succs_start;
+  relation_node *succs;
+} sccs;
+
+#define SCC_ROOT(Sccs, C) ((Sccs)->members[(Sccs)->start[(C) + 1] - 1])
+
+/* Compute the SCCs of R, of SIZE nodes, in reverse topological
+   order.  */
 static void
-traverse (relation_node i)
+sccs_compute (sccs *res, relation r, relation_node size)
 {
-  vertices[++top] = i;
-  relation_node height = indexes[i] = top;
+  /* INDEXES[V] is the DFS number of V (0 if not visited yet),
+     LOWLINKS[V] the smallest DFS number reachable from V in the
+     current DFS tree, or INFINITY once V was assigned an SCC.  */
+  relation_node infinity = size + 2;
+  relation_nodes indexes = xcalloc (size, sizeof *indexes);
+  relation_nodes lowlinks = xnmalloc (size, sizeof *lowlinks);
+  /* The SCC of each node.  */
+  relation_nodes comp = xnmalloc (size, sizeof *comp);
+  /* Tarjan's stack of nodes not yet assigned an SCC.  */
+  relation_nodes vertices = xnmalloc (size, sizeof *vertices);
+  relation_node top = 0;
+  /* The DFS stack: nodes, and the index of the next edge to visit.  */
+  relation_nodes dfs_nodes = xnmalloc (size, sizeof *dfs_nodes);
+  relation_nodes dfs_edges = xnmalloc (size, sizeof *dfs_edges);
+  relation_node dfs_top = 0;
+  relation_node counter = 0;
+
+  res->ncomps = 0;
+  res->start = xnmalloc (size + 1, sizeof *res->start);
+  res->members = xnmalloc (size, sizeof *res->members);
+  relation_node nmembers = 0;
 
-  if (R[i])
-    for (relation_node j = 0; R[i][j] != END_NODE; ++j)
+  for (relation_node i = 0; i < size; ++i)
+    if (!indexes[i])
       {
-        if (indexes[R[i][j]] == 0)
-          traverse (R[i][j]);
-
-        if (indexes[i] > indexes[R[i][j]])
-          indexes[i] = indexes[R[i][j]];
+        indexes[i] = lowlinks[i] = ++counter;
+        vertices[top++] = i;
+        dfs_nodes[dfs_top] = i;
+        dfs_edges[dfs_top] = 0;
+        ++dfs_top;
 
-        bitset_or (F[i], F[i], F[R[i][j]]);
+        while (dfs_top)
+          {
+            relation_node v = dfs_nodes[dfs_top - 1];
+            relation_node e = dfs_edges[dfs_top - 1];
+            if (r[v] && r[v][e] != END_NODE)
+              {
+                dfs_edges[dfs_top - 1] = e + 1;
+                relation_node w = r[v][e];
+                if (!indexes[w])
+                  {
+                    indexes[w] = lowlinks[w] = ++counter;
+                    vertices[top++] = w;
+                    dfs_nodes[dfs_top] = w;
+                    dfs_edges[dfs_top] = 0;
+                    ++dfs_top;
+                  }
+                else if (lowlinks[w] != infinity && indexes[w] < lowlinks[v])
+                  lowlinks[v] = indexes[w];
+              }
+            else
+              {
+                --dfs_top;
+                if (dfs_top)
+                  {
+                    relation_node u = dfs_nodes[dfs_top - 1];
+                    if (lowlinks[v] < lowlinks[u])
+                      lowlinks[u] = lowlinks[v];
+                  }
+                if (lowlinks[v] == indexes[v])
+                  {
+                    /* V is the root of an SCC: pop it, root last.  */
+                    res->start[res->ncomps] = nmembers;
+                    relation_node w;
+                    do
+                      {
+                        w = vertices[--top];
+                        lowlinks[w] = infinity;
+                        comp[w] = res->ncomps;
+                        if (w != v)
+                          res->members[nmembers++] = w;
+                      }
+                    while (w != v);
+                    res->members[nmembers++] = v;
+                    ++res->ncomps;
+                  }
+              }
+          }
       }
+  res->start[res->ncomps] = nmembers;
+
+  /* The condensed graph.  STAMPS[D] is C + 1 if D was already recorded
+     as a successor of C.  */
+  relation_nodes stamps = indexes;
+  memset (stamps, 0, size * sizeof *stamps);
+  res->succs_start = xnmalloc (res->ncomps + 1, sizeof *res->succs_start);
+  size_t succs_alloc = 0;
+  res->succs = NULL;
+  relation_node nsuccs = 0;
+  for (relation_node c = 0; c < res->ncomps; ++c)
+    {
+      res->succs_start[c] = nsuccs;
+      for (relation_node m = res->start[c]; m < res->start[c + 1]; ++m)
+        {
+          relation_node v = res->members[m];
+          if (r[v])
+            for (relation_node j = 0; r[v][j] != END_NODE; ++j)
+              {
+                relation_node d = comp[r[v][j]];
+                if (d != c && stamps[d] != c + 1)
+                  {
+                    stamps[d] = c + 1;
+                    if (nsuccs == succs_alloc)
+                      res->succs = x2nrealloc (res->succs, &succs_alloc,
+                                               sizeof *res->succs);
+                    res->succs[nsuccs++] = d;
+                  }
+              }
+        }
+    }
+  res->succs_start[res->ncomps] = nsuccs;
 
-  if (indexes[i] == height)
-    for (;;)
-      {
-        relation_node j = vertices[top--];
-        indexes[j] = infinity;
+  free (indexes);
+  free (lowlinks);
+  free (comp);
+  free (vertices);
+  free (dfs_nodes);
+  free (dfs_edges);
+}
 
-        if (i == j)
-          break;
+static void
+sccs_free (sccs *s)
+{
+  free (s->start);
+  free (s->members);
+  free (s->succs_start);
+  free (s->succs);
+}
 
-        bitset_copy (F[j], F[i]);
-      }
+/* Compute the final value of F for the SCC C, whose successors are
+   already complete.  Modifies only the rows of the members of C, so
+   SCCs whose successors are complete can be processed concurrently.  */
+static void
+scc_propagate (sccs const *s, relation_node c, bitsetv F)
+{
+  relation_node root = SCC_ROOT (s, c);
+  relation_node last = s->start[c + 1] - 1;
+  for (relation_node m = s->start[c]; m < last; ++m)
+    bitset_or (F[root], F[root], F[s->members[m]]);
+  for (relation_node d = s->succs_start[c]; d < s->succs_start[c + 1]; ++d)
+    bitset_or (F[root], F[root], F[SCC_ROOT (s, s->succs[d])]);
+  for (relation_node m = s->start[c]; m < last; ++m)
+    bitset_copy (F[s->members[m]], F[root]);
 }
 
 
-void
-relation_digraph (relation r, relation_node size, bitsetv function)
+/*-----------------------------------------------------------------.
+| Parallel propagation.  The SCCs are grouped by level: the level  |
+| of an SCC is 0 if it has no successors, otherwise 1 plus the max |
+| level of its successors.  The SCCs of a given level are          |
+| independent, and are processed concurrently.                     |
+`-----------------------------------------------------------------*/
+
+/* Levels with fewer SCCs than this are processed by the main thread
+   only.  */
+#define DIGRAPH_LEVEL_MIN 256
+
+typedef struct
+{
+  sccs const *sccs;
+  bitsetv F;
+  /* The SCCs to process.  */
+  relation_node const *comps;
+  relation_node ncomps;
+} digraph_worker;
+
+static void *
+digraph_worker_run (void *arg)
 {
-  infinity = size + 2;
-  indexes = xcalloc (size + 1, sizeof *indexes);
-  vertices = xnmalloc (size + 1, sizeof *vertices);
-  top = 0;
+  digraph_worker const *w = arg;
+  for (relation_node i = 0; i < w->ncomps; ++i)
+    scc_propagate (w->sccs, w->comps[i], w->F);
+  return NULL;
+}
 
-  R = r;
-  F = function;
+static void
+sccs_propagate_parallel (sccs const *s, bitsetv F, int nworkers)
+{
+  relation_node ncomps = s->ncomps;
+  relation_nodes levels = xnmalloc (ncomps, sizeof *levels);
+  relation_node nlevels = 0;
+  for (relation_node c = 0; c < ncomps; ++c)
+    {
+      relation_node l = 0;
+      for (relation_node d = s->succs_start[c]; d < s->succs_start[c + 1]; ++d)
+        if (l < levels[s->succs[d]] + 1)
+          l = levels[s->succs[d]] + 1;
+      levels[c] = l;
+      if (nlevels < l + 1)
+        nlevels = l + 1;
+    }
 
-  for (relation_node i = 0; i < size; i++)
-    if (indexes[i] == 0 && R[i])
-      traverse (i);
+  /* Sort the SCCs by level (counting sort).  */
+  relation_nodes level_start = xcalloc (nlevels + 1, sizeof *level_start);
+  for (relation_node c = 0; c < ncomps; ++c)
+    ++level_start[levels[c] + 1];
+  for (relation_node l = 0; l < nlevels; ++l)
+    level_start[l + 1] += level_start[l];
+  relation_nodes comps = xnmalloc (ncomps, sizeof *comps);
+  {
+    relation_nodes next = xmemdup (level_start, nlevels * sizeof *next);
+    for (relation_node c = 0; c < ncomps; ++c)
+      comps[next[levels[c]]++] = c;
+    free (next);
+  }
+
+  digraph_worker *workers = xnmalloc (nworkers, sizeof *workers);
+  gl_thread_t *threads = xnmalloc (nworkers, sizeof *threads);
+  bool *started = xnmalloc (nworkers, sizeof *started);
+  for (relation_node l = 0; l < nlevels; ++l)
+    {
+      relation_node lo = level_start[l];
+      relation_node n = level_start[l + 1] - lo;
+      int nw = n < DIGRAPH_LEVEL_MIN ? 1 : nworkers;
+      for (int i = 0; i < nw; ++i)
+        {
+          workers[i].sccs = s;
+          workers[i].F = F;
+          workers[i].comps = comps + lo + n * i / nw;
+          workers[i].ncomps = n * (i + 1) / nw - n * i / nw;
+          /* Worker 0 is the main thread.  If a thread cannot be
+             started, the main thread does its job.  */
+          started[i] = 0 < i && !glthread_create (&threads[i],
+                                                  digraph_worker_run,
+                                                  &workers[i]);
+        }
+      for (int i = 0; i < nw; ++i)
+        if (!started[i])
+          digraph_worker_run (&workers[i]);
+      for (int i = 1; i < nw; ++i)
+        if (started[i])
+          glthread_join (threads[i], NULL);
+    }
+
+  free (started);
+  free (threads);
+  free (workers);
+  free (comps);
+  free (level_start);
+  free (levels);
+}
 
-  free (indexes);
-  free (vertices);
 
-  function = F;
+void
+relation_digraph (relation r, relation_node size, bitsetv function)
+{
+  sccs s;
+  sccs_compute (&s, r, size);
+
+  /* Bitset statistics are not thread safe, and neither are list
+     bitsets (sparse lookahead sets): they share a free list.  */
+  if (1 < jobs && !(trace_flag & trace_bitsets)
+      && 0 < size && bitset_type_get (function[0]) != BITSET_LIST)
+    sccs_propagate_parallel (&s, function, jobs);
+  else
+    /* Successors come first.  */
+    for (relation_node c = 0; c < s.ncomps; ++c)
+      scc_propagate (&s, c, function);
+
+  sccs_free (&s);
 }
 
 
@@ -46,7 +46,12 @@ void relation_print (const char *title,
    If R (NODE1, NODE2) then on exit FUNCTION[NODE1] was extended
    (unioned) with FUNCTION[NODE2].
 
-   FUNCTION is in-out, R is read only.  */
+   FUNCTION is in-out, R is read only.
+
+   Runs in time linear in the size of R (plus one union per edge of the
+   graph of its strongly connected components, and one copy per node),
+   without recursion.  With --jobs, independent components are processed
+   concurrently.  */
 void relation_digraph (const relation r, relation_node size, bitsetv function);
 
 /* Destructively transpose *R_ARG, of size SIZE.  */
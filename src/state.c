@@ -23,8 +23,6 @@
 
 #include "system.h"
 
-#include <hash.h>
-
 #include "closure.h"
 #include "complain.h"
 #include "getargs.h"
@@ -32,6 +30,99 @@
 #include "print-xml.h"
 
 
+                        /*----------.
+                        | Storage.  |
+                        `----------*/
+
+/* The objects of the automaton (states, transitions, reductions and
+   errs) are allocated in obstacks, one per kind of object.  Objects of
+   a given kind are therefore contiguous, and since they are created in
+   the order of the state numbers, the passes that walk STATES also
+   walk memory in order.  They are all freed at once by states_free.  */
+
+typedef enum
+  {
+    storage_states,
+    storage_transitions,
+    storage_reductions,
+    storage_errs,
+    storage_num
+  } storage_kind;
+
+typedef struct
+{
+  struct obstack obstack;
+  /* Number of objects allocated, and their total size in bytes.  */
+  size_t count;
+  size_t size;
+} storage;
+
+static storage storages[storage_num];
+
+static char const *const storage_names[storage_num] =
+  {
+    "states",
+    "transitions",
+    "reductions",
+    "errs",
+  };
+
+static bool storages_initialized = false;
+
+/* Allocate SIZE bytes for an object of kind KIND.  */
+static void *
+storage_alloc (storage_kind kind, size_t size)
+{
+  if (!storages_initialized)
+    {
+      for (int i = 0; i < storage_num; ++i)
+        {
+          obstack_init (&storages[i].obstack);
+          storages[i].count = 0;
+          storages[i].size = 0;
+        }
+      storages_initialized = true;
+    }
+  storage *st = &storages[kind];
+  st->count += 1;
+  st->size += size;
+  return obstack_alloc (&st->obstack, size);
+}
+
+/* Report the memory used by the automaton.  */
+static void
+storage_print (FILE *out)
+{
+  fputs ("automaton storage:\n", out);
+  size_t total_size = 0;
+  size_t total_used = 0;
+  for (int i = 0; i < storage_num; ++i)
+    {
+      storage *st = &storages[i];
+      size_t allocated = obstack_memory_used (&st->obstack);
+      fprintf (out, "  %-12s %8zu objects, %10zu bytes (%zu allocated)\n",
+               storage_names[i], st->count, st->size, allocated);
+      total_size += st->size;
+      total_used += allocated;
+    }
+  fprintf (out, "  %-12s %8s          %10zu bytes (%zu allocated)\n",
+           "total", "", total_size, total_used);
+}
+
+static void
+storage_free (void)
+{
+  if (storages_initialized)
+    {
+      if (trace_flag & trace_resource)
+        storage_print (stderr);
+      for (int i = 0; i < storage_num; ++i)
+        obstack_free (&storages[i].obstack, NULL);
+      storages_initialized = false;
+    }
+}
+
+
                         /*-------------------.
                         | Shifts and Gotos.  |
                         `-------------------*/
@@ -45,7 +136,9 @@ static transitions *
 transitions_new (int num, state **dst)
 {
   size_t states_size = num * sizeof *dst;
-  transitions *res = xmalloc (offsetof (transitions, states) + states_size);
+  transitions *res = storage_alloc (storage_transitions,
+                                    offsetof (transitions, states)
+                                    + states_size);
   res->num = num;
   memcpy (res->states, dst, states_size);
   return res;
@@ -55,10 +148,22 @@ transitions_new (int num, state **dst)
 state *
 transitions_to (state *s, symbol_number sym)
 {
+  /* Transitions are sorted by accessing symbol (tokens first, then
+     nterms), so a binary search suffices.  */
   transitions *trans = s->transitions;
-  for (int i = 0; i < trans->num; ++i)
-    if (TRANSITION_SYMBOL (trans, i) == sym)
-      return trans->states[i];
+  int low = 0;
+  int high = trans->num - 1;
+  while (low <= high)
+    {
+      int middle = low + (high - low) / 2;
+      symbol_number msym = TRANSITION_SYMBOL (trans, middle);
+      if (msym == sym)
+        return trans->states[middle];
+      else if (msym < sym)
+        low = middle + 1;
+      else
+        high = middle - 1;
+    }
   abort ();
 }
 
@@ -76,7 +181,8 @@ errs *
 errs_new (int num, symbol **tokens)
 {
   size_t symbols_size = num * sizeof *tokens;
-  errs *res = xmalloc (offsetof (errs, symbols) + symbols_size);
+  errs *res = storage_alloc (storage_errs,
+                             offsetof (errs, symbols) + symbols_size);
   res->num = num;
   if (tokens)
     memcpy (res->symbols, tokens, symbols_size);
@@ -99,7 +205,8 @@ static reductions *
 reductions_new (int num, rule **reds)
 {
   size_t rules_size = num * sizeof *reds;
-  reductions *res = xmalloc (offsetof (reductions, rules) + rules_size);
+  reductions *res = storage_alloc (storage_reductions,
+                                   offsetof (reductions, rules) + rules_size);
   res->num = num;
   res->lookahead_tokens = NULL;
   memcpy (res->rules, reds, rules_size);
@@ -131,7 +238,8 @@ state_new (symbol_number accessing_symbol,
   aver (nstates < STATE_NUMBER_MAXIMUM);
 
   size_t items_size = nitems * sizeof *core;
-  state *res = xmalloc (offsetof (state, items) + items_size);
+  state *res = storage_alloc (storage_states,
+                              offsetof (state, items) + items_size);
   res->number = nstates++;
   res->accessing_symbol = accessing_symbol;
   res->transitions = NULL;
@@ -156,7 +264,8 @@ state_new_isocore (state const *s)
   aver (nstates < STATE_NUMBER_MAXIMUM);
 
   size_t items_size = s->nitems * sizeof *s->items;
-  state *res = xmalloc (offsetof (state, items) + items_size);
+  state *res = storage_alloc (storage_states,
+                              offsetof (state, items) + items_size);
   res->number = nstates++;
   res->accessing_symbol = s->accessing_symbol;
   res->transitions =
@@ -175,20 +284,6 @@ state_new_isocore (state const *s)
 }
 
 
-/*---------.
-| Free S.  |
-`---------*/
-
-static void
-state_free (state *s)
-{
-  free (s->transitions);
-  free (s->reductions);
-  free (s->errs);
-  free (s);
-}
-
-
 void
 state_transitions_print (const state *s, FILE *out)
 {
@@ -310,45 +405,110 @@ state_rule_lookahead_tokens_print_xml (state *s, rule const *r,
 | A state hash table.  |
 `---------------------*/
 
-/* Initial capacity of states hash table.  */
-#define HT_INITIAL_CAPACITY 257
+/* An open addressing table (with linear probing) of the states,
+   indexed by their core.  Lookups take a view on a core (its size and
+   its items), so, contrary to a generic hash table, they do not need
+   to build a probe state.  Lookups do not modify the table (unless
+   statistics are collected, which is the case only in serial mode), so
+   generate_states may run them concurrently.  */
 
-static struct hash_table *state_table = NULL;
+/* Initial capacity of states hash table.  Must be a power of 2.  */
+#define HT_INITIAL_CAPACITY 256
 
-/* Two states are equal if they have the same core items.  */
+typedef struct
+{
+  /* The hash of the core of STATE, to avoid comparing the cores of
+     states that cannot be equal, and to rehash without recomputing
+     it.  */
+  size_t hash;
+  /* Null for empty slots.  */
+  state *state;
+} state_hash_slot;
+
+static state_hash_slot *state_table = NULL;
+static size_t state_table_capacity = 0;
+static size_t state_table_count = 0;
+
+/* Statistics on the state table, collected for --trace=automaton.  */
+static size_t state_table_lookups = 0;
+static size_t state_table_probes = 0;
+static size_t state_table_probes_max = 0;
+/* Number of times two different cores had the same hash.  */
+static size_t state_table_collisions = 0;
+
+/* Whether the core of S is CORE (of size NITEMS).  */
 static inline bool
-state_compare (state const *s1, state const *s2)
+state_core_eq (state const *s, size_t nitems, item_number const *core)
 {
-  if (s1->nitems != s2->nitems)
-    return false;
-
-  for (size_t i = 0; i < s1->nitems; ++i)
-    if (s1->items[i] != s2->items[i])
-      return false;
-
-  return true;
+  return (s->nitems == nitems
+          && !memcmp (s->items, core, nitems * sizeof *core));
 }
 
-static bool
-state_comparator (void const *s1, void const *s2)
+/* Hash the item numbers with FNV-1a, then mix the bits with the
+   finalizer of MurmurHash3: plain sums, or weak mixes, collide for
+   permuted or shifted sets of items, which are very frequent.  */
+static inline size_t
+core_hash (size_t nitems, item_number const *core)
 {
-  return state_compare (s1, s2);
+  uint64_t res = UINT64_C (14695981039346656037) ^ nitems;
+  for (size_t i = 0; i < nitems; ++i)
+    {
+      res ^= (uint32_t) core[i];
+      res *= UINT64_C (1099511628211);
+    }
+  res ^= res >> 33;
+  res *= UINT64_C (0xff51afd7ed558ccd);
+  res ^= res >> 33;
+  res *= UINT64_C (0xc4ceb9fe1a85ec53);
+  res ^= res >> 33;
+  return res;
 }
 
-static inline size_t
-state_hash (state const *s, size_t tablesize)
+/* Where the state with core CORE (of size NITEMS), whose hash is
+   HASH, is or should be inserted.  */
+static state_hash_slot *
+state_hash_find (size_t hash, size_t nitems, item_number const *core)
 {
-  /* Add up the state's item numbers to get a hash key.  */
-  size_t key = 0;
-  for (size_t i = 0; i < s->nitems; ++i)
-    key += s->items[i];
-  return key % tablesize;
+  size_t mask = state_table_capacity - 1;
+  size_t probes = 1;
+  size_t i = hash & mask;
+  for (; state_table[i].state; i = (i + 1) & mask, ++probes)
+    if (state_table[i].hash == hash)
+      {
+        if (state_core_eq (state_table[i].state, nitems, core))
+          break;
+        else if (trace_flag & trace_automaton)
+          ++state_table_collisions;
+      }
+
+  if (trace_flag & trace_automaton)
+    {
+      ++state_table_lookups;
+      state_table_probes += probes;
+      if (state_table_probes_max < probes)
+        state_table_probes_max = probes;
+    }
+  return &state_table[i];
 }
 
-static size_t
-state_hasher (void const *s, size_t tablesize)
+/* Double the capacity of the table.  */
+static void
+state_hash_grow (void)
 {
-  return state_hash (s, tablesize);
+  state_hash_slot *old = state_table;
+  size_t old_capacity = state_table_capacity;
+  state_table_capacity *= 2;
+  state_table = xcalloc (state_table_capacity, sizeof *state_table);
+  size_t mask = state_table_capacity - 1;
+  for (size_t i = 0; i < old_capacity; ++i)
+    if (old[i].state)
+      {
+        size_t j = old[i].hash & mask;
+        while (state_table[j].state)
+          j = (j + 1) & mask;
+        state_table[j] = old[i];
+      }
+  free (old);
 }
 
 
@@ -359,11 +519,13 @@ state_hasher (void const *s, size_t tablesize)
 void
 state_hash_new (void)
 {
-  state_table = hash_xinitialize (HT_INITIAL_CAPACITY,
-                                  NULL,
-                                  state_hasher,
-                                  state_comparator,
-                                  NULL);
+  state_table_capacity = HT_INITIAL_CAPACITY;
+  state_table_count = 0;
+  state_table = xcalloc (state_table_capacity, sizeof *state_table);
+  state_table_lookups = 0;
+  state_table_probes = 0;
+  state_table_probes_max = 0;
+  state_table_collisions = 0;
 }
 
 
@@ -374,7 +536,21 @@ state_hash_new (void)
 void
 state_hash_free (void)
 {
-  hash_free (state_table);
+  if (trace_flag & trace_automaton)
+    fprintf (stderr,
+             "state hash table: %zu states, capacity %zu, "
+             "%zu lookups, %.2f probes per lookup (max %zu), "
+             "%zu hash collisions\n",
+             state_table_count, state_table_capacity,
+             state_table_lookups,
+             state_table_lookups
+             ? (double) state_table_probes / state_table_lookups : 0.0,
+             state_table_probes_max,
+             state_table_collisions);
+  free (state_table);
+  state_table = NULL;
+  state_table_capacity = 0;
+  state_table_count = 0;
 }
 
 
@@ -385,8 +561,15 @@ state_hash_free (void)
 void
 state_hash_insert (state *s)
 {
-  if (!hash_insert (state_table, s))
-    xalloc_die ();
+  /* Keep the load factor below 1/2.  */
+  if (state_table_capacity < 2 * (state_table_count + 1))
+    state_hash_grow ();
+  size_t hash = core_hash (s->nitems, s->items);
+  state_hash_slot *slot = state_hash_find (hash, s->nitems, s->items);
+  aver (!slot->state);
+  slot->hash = hash;
+  slot->state = s;
+  ++state_table_count;
 }
 
 
@@ -396,15 +579,9 @@ state_hash_insert (state *s)
 `------------------------------------------------------------------*/
 
 state *
-state_hash_lookup (size_t nitems, item_number *core)
+state_hash_lookup (size_t nitems, item_number const *core)
 {
-  size_t items_size = nitems * sizeof *core;
-  state *probe = xmalloc (offsetof (state, items) + items_size);
-  probe->nitems = nitems;
-  memcpy (probe->items, core, items_size);
-  state *entry = hash_lookup (state_table, probe);
-  free (probe);
-  return entry;
+  return state_hash_find (core_hash (nitems, core), nitems, core)->state;
 }
 
 
@@ -438,10 +615,8 @@ state_remove_unreachable_states (state_number old_to_new[])
           old_to_new[i] = nstates_reachable++;
         }
       else
-        {
-          state_free (states[i]);
-          old_to_new[i] = nstates;
-        }
+        /* Its storage is reclaimed by states_free.  */
+        old_to_new[i] = nstates;
     }
   nstates = nstates_reachable;
   bitset_free (reachable);
@@ -459,7 +634,6 @@ void
 states_free (void)
 {
   closure_free ();
-  for (state_number i = 0; i < nstates; ++i)
-    state_free (states[i]);
+  storage_free ();
   free (states);
 }
@@ -160,7 +160,9 @@ typedef struct
 
 
 /* The destination of the transition (shift/goto) from state S on
-   label SYM (term or nterm).  Abort if none found.  */
+   label SYM (term or nterm).  Abort if none found.  Runs in
+   logarithmic time, but must not be used once transitions have been
+   disabled.  */
 struct state *transitions_to (state *s, symbol_number sym);
 
 
@@ -260,8 +262,9 @@ void state_hash_new (void);
 void state_hash_free (void);
 
 /* Find the state associated to the CORE, and return it.  If it does
-   not exist yet, return NULL.  */
-state *state_hash_lookup (size_t core_size, item_number *core);
+   not exist yet, return NULL.  Does not allocate, and can be called
+   concurrently, provided no state is inserted meanwhile.  */
+state *state_hash_lookup (size_t core_size, item_number const *core);
 
 /* Insert STATE in the state hash table.  */
 void state_hash_insert (state *s);
@@ -269,13 +272,15 @@ void state_hash_insert (state *s);
 /* Remove unreachable states, renumber remaining states, update NSTATES, and
    write to OLD_TO_NEW a mapping of old state numbers to new state numbers such
    that the old value of NSTATES is written as the new state number for removed
-   states.  The size of OLD_TO_NEW must be the old value of NSTATES.  */
+   states.  The size of OLD_TO_NEW must be the old value of NSTATES.  The
+   memory of the removed states is reclaimed by states_free.  */
 void state_remove_unreachable_states (state_number old_to_new[]);
 
 /* All the states, indexed by the state number.  */
 extern state **states;
 
-/* Free all the states.  */
+/* Free all the states, their transitions, reductions and errs.  With
+   --trace=resource, report the memory they used.  */
 void states_free (void);
 
 #endif /* !STATE_H_ */
@@ -23,6 +23,7 @@
 
 #include <bitset.h>
 #include <bitsetv.h>
+#include <hash.h>
 
 #include "complain.h"
 #include "conflicts.h"
@@ -31,6 +32,7 @@
 #include "gram.h"
 #include "lalr.h"
 #include "muscle-tab.h"
+#include "profile.h"
 #include "reader.h"
 #include "symtab.h"
 #include "tables.h"
@@ -135,9 +137,29 @@ base_number table_ninf = 0;
 static int lowzero;
 int high;
 
+/* NEXT_FREE is a forest over the slots of TABLE used to find the
+   first free slot at or after a given location in amortized constant
+   time.  A slot LOC is free iff TABLE[LOC] is 0; free slots are
+   roots, and an occupied slot LOC points to a later slot (initially
+   LOC + 1).  Since slots are never released, paths can be compressed.
+   NEXT_FREE is not initialized: entries are set when slots are
+   filled.  */
+static int *next_free;
+
 state_number *yydefgoto;
 rule_number *yydefact;
 
+symbol_number *yystos = NULL;
+state_number yyfinal = 0;
+
+table_encoding tables_encoding = table_encoding_packed;
+base_number *yyaction = NULL;
+int *yyactrow = NULL;
+int nactrows = 0;
+/* The range of the values of YYACTION.  */
+static base_number action_min = 0;
+static base_number action_max = 0;
+
 /*-------------------------------------------------------------------.
 | If TABLE, CONFLICT_TABLE, and CHECK are too small to be addressed  |
 | at DESIRED, grow them.  TABLE[DESIRED] can be used, so the desired |
@@ -169,6 +191,8 @@ table_grow (int desired)
   for (int i = old_size; i < table_size; ++i)
     check[i] = -1;
 
+  next_free = xnrealloc (next_free, table_size, sizeof *next_free);
+
   bitset_resize (pos_set, table_size + nstates);
 }
 
@@ -566,30 +590,117 @@ goto_actions (void)
 | pack the actions and gotos information into yytable.              |
 `------------------------------------------------------------------*/
 
+/* Order the vectors by decreasing width, then decreasing tally, then
+   increasing vector number (so that the sort is stable).  */
+static int
+vector_cmp (void const *a, void const *b)
+{
+  vector_number v1 = *(vector_number const *) a;
+  vector_number v2 = *(vector_number const *) b;
+  return (width[v1] != width[v2] ? (width[v1] < width[v2] ? 1 : -1)
+          : tally[v1] != tally[v2] ? (tally[v1] < tally[v2] ? 1 : -1)
+          : (v2 < v1) - (v1 < v2));
+}
+
 static void
 sort_actions (void)
 {
   nentries = 0;
-
   for (int i = 0; i < nvectors; i++)
     if (0 < tally[i])
-      {
-        const size_t t = tally[i];
-        const int w = width[i];
-        int j = nentries - 1;
+      order[nentries++] = i;
+  qsort (order, nentries, sizeof *order, vector_cmp);
+}
+
+
+/* The vectors already packed, indexed by their contents (FROMS and
+   TOS), so that matching_state does not have to compare VECTOR with
+   all the previous ones.  Vectors with GLR conflicts are not
+   indexed.  */
 
-        while (0 <= j && width[order[j]] < w)
-          j--;
+typedef struct
+{
+  /* When several packed vectors have the same contents, the last
+     one.  */
+  vector_number vector;
+  /* The hash of the contents of VECTOR.  */
+  size_t hash;
+} row_entry;
+
+/* Initial capacity of ROW_TABLE.  */
+#define ROW_TABLE_INITIAL_CAPACITY 1021
+
+static struct hash_table *row_table = NULL;
+/* The entries of ROW_TABLE, indexed by vector number.  */
+static row_entry *row_entries = NULL;
+
+static bool
+row_entry_comparator (void const *e1, void const *e2)
+{
+  vector_number v1 = ((row_entry const *) e1)->vector;
+  vector_number v2 = ((row_entry const *) e2)->vector;
+  return (tally[v1] == tally[v2]
+          && (!tally[v1]
+              || (!memcmp (froms[v1], froms[v2],
+                           tally[v1] * sizeof *froms[v1])
+                  && !memcmp (tos[v1], tos[v2],
+                              tally[v1] * sizeof *tos[v1]))));
+}
 
-        while (0 <= j && width[order[j]] == w && tally[order[j]] < t)
-          j--;
+static size_t
+row_entry_hasher (void const *e, size_t tablesize)
+{
+  return ((row_entry const *) e)->hash % tablesize;
+}
 
-        for (int k = nentries - 1; k > j; k--)
-          order[k + 1] = order[k];
+/* Whether VECTOR has GLR conflicts.  */
+static bool
+row_has_conflicts (vector_number vector)
+{
+  if (conflict_tos[vector])
+    for (size_t k = 0; k < tally[vector]; k++)
+      if (conflict_tos[vector][k] != 0)
+        return true;
+  return false;
+}
 
-        order[j + 1] = i;
-        nentries++;
-      }
+static void
+row_table_new (void)
+{
+  row_table = hash_xinitialize (ROW_TABLE_INITIAL_CAPACITY,
+                                NULL,
+                                row_entry_hasher,
+                                row_entry_comparator,
+                                NULL);
+  row_entries = xnmalloc (nvectors, sizeof *row_entries);
+  for (int i = 0; i < nvectors; i++)
+    {
+      size_t key = tally[i];
+      for (size_t k = 0; k < tally[i]; k++)
+        key = (key * 31 + froms[i][k]) * 31 + tos[i][k];
+      row_entries[i].vector = i;
+      row_entries[i].hash = key;
+    }
+}
+
+static void
+row_table_free (void)
+{
+  hash_free (row_table);
+  row_table = NULL;
+  free (row_entries);
+  row_entries = NULL;
+}
+
+/* Record that VECTOR was packed.  */
+static void
+row_table_insert (vector_number vector)
+{
+  if (!row_has_conflicts (vector))
+    {
+      row_entry *e = hash_xinsert (row_table, &row_entries[vector]);
+      e->vector = vector;
+    }
 }
 
 
@@ -603,42 +714,45 @@ static state_number
 matching_state (vector_number vector)
 {
   vector_number i = order[vector];
-  /* If VECTOR is a nterm, return -1.  */
-  if (i < nstates)
+  /* If VECTOR is a nterm, or has GLR conflicts, return -1.  */
+  if (i < nstates && !row_has_conflicts (i))
     {
-      size_t t = tally[i];
-      int w = width[i];
+      row_entry const *match = hash_lookup (row_table, &row_entries[i]);
+      if (match)
+        return match->vector;
+    }
+  return -1;
+}
 
-      /* If VECTOR has GLR conflicts, return -1 */
-      if (conflict_tos[i] != NULL)
-        for (int j = 0; j < t; j += 1)
-          if (conflict_tos[i][j] != 0)
-            return -1;
 
-      for (int prev = vector - 1; 0 <= prev; prev--)
-        {
-          vector_number j = order[prev];
-          /* Given how ORDER was computed, if the WIDTH or TALLY is
-             different, there cannot be a matching state.  */
-          if (width[j] != w || tally[j] != t)
-            return -1;
-          else
-            {
-              bool match = true;
-              for (int k = 0; match && k < t; k++)
-                if (tos[j][k] != tos[i][k]
-                    || froms[j][k] != froms[i][k]
-                    || (conflict_tos[j] != NULL && conflict_tos[j][k] != 0))
-                  match = false;
-              if (match)
-                return j;
-            }
-        }
+/* The first free slot of TABLE at or after LOC.  Slots past the end
+   of TABLE are free.  */
+static int
+table_next_free (int loc)
+{
+  int res = loc;
+  while (res < table_size && table[res] != 0)
+    res = next_free[res];
+  /* Compress the path.  */
+  while (loc != res)
+    {
+      int next = next_free[loc];
+      next_free[loc] = res;
+      loc = next;
     }
-  return -1;
+  return res;
 }
 
 
+/* Find the lowest base RES, starting at LOWZERO - FROM[0], such that
+   the slots RES + FROM[K] of TABLE are all free, and RES is not used
+   by another vector (POS_SET).  Fill these slots and return RES.
+
+   Rather than trying each base in turn, when the slot of an entry is
+   occupied, skip directly to the first base where this slot is free:
+   no base in between can fit.  The entry that failed last is checked
+   first, since it is most likely to fail again.  */
+
 static base_number
 pack_vector (vector_number vector)
 {
@@ -650,24 +764,35 @@ pack_vector (vector_number vector)
 
   aver (t != 0);
 
-  for (base_number res = lowzero - from[0]; ; res++)
+  /* The entry checked first.  */
+  int first = 0;
+  for (base_number res = lowzero - from[0]; ; )
     {
       bool ok = true;
       aver (res < table_size);
-      {
-        for (int k = 0; ok && k < t; k++)
-          {
-            int loc = res + state_number_as_int (from[k]);
-            if (table_size <= loc)
-              table_grow (loc);
+      for (int j = 0; ok && j < t; j++)
+        {
+          int k = (first + j) % t;
+          int loc = res + state_number_as_int (from[k]);
+          if (table_size <= loc)
+            table_grow (loc);
 
-            if (table[loc] != 0)
+          int free_loc = table_next_free (loc);
+          if (free_loc != loc)
+            {
+              if (table_size <= free_loc)
+                table_grow (free_loc);
+              res += free_loc - loc;
+              first = k;
               ok = false;
-          }
+            }
+        }
 
-        if (ok && bitset_test (pos_set, nstates + res))
+      if (ok && bitset_test (pos_set, nstates + res))
+        {
+          res++;
           ok = false;
-      }
+        }
 
       if (ok)
         {
@@ -676,13 +801,13 @@ pack_vector (vector_number vector)
             {
               loc = res + state_number_as_int (from[k]);
               table[loc] = to[k];
+              next_free[loc] = loc + 1;
               if (nondeterministic_parser && conflict_to != NULL)
                 conflict_table[loc] = conflict_to[k];
               check[loc] = from[k];
             }
 
-          while (table[lowzero] != 0)
-            lowzero++;
+          lowzero = table_next_free (lowzero);
 
           if (high < loc)
             high = loc;
@@ -728,6 +853,7 @@ pack_table (void)
   table = xcalloc (table_size, sizeof *table);
   conflict_table = xcalloc (table_size, sizeof *conflict_table);
   check = xnmalloc (table_size, sizeof *check);
+  next_free = xnmalloc (table_size, sizeof *next_free);
 
   lowzero = 0;
   high = 0;
@@ -738,6 +864,7 @@ pack_table (void)
   for (int i = 0; i < table_size; i++)
     check[i] = -1;
 
+  row_table_new ();
   for (int i = 0; i < nentries; i++)
     {
       state_number s = matching_state (i);
@@ -757,22 +884,86 @@ pack_table (void)
       if (0 <= nstates + place)
         bitset_set (pos_set, nstates + place);
       base[order[i]] = place;
+      row_table_insert (order[i]);
     }
+  row_table_free ();
 
   /* Use the greatest possible negative infinites.  */
   base_ninf = table_ninf_remap (base, nvectors, BASE_MINIMUM);
   table_ninf = table_ninf_remap (table, high + 1, ACTION_NUMBER_MINIMUM);
 
   bitset_free (pos_set);
+  free (next_free);
+  next_free = NULL;
 }
 
 
 
+/*-------------------------------------------------------------------.
+| Compute YYACTROW and NACTROWS, and, unless the encoding is packed, |
+| YYACTION.                                                          |
+`-------------------------------------------------------------------*/
+
+static void
+action_rows_compute (void)
+{
+  row_table_new ();
+  yyactrow = xnmalloc (nstates, sizeof *yyactrow);
+  nactrows = 0;
+  for (state_number s = 0; s < nstates; ++s)
+    {
+      row_entry const *e = hash_xinsert (row_table, &row_entries[s]);
+      yyactrow[s] = e == &row_entries[s] ? nactrows++ : yyactrow[e->vector];
+    }
+  row_table_free ();
+
+  action_min = action_max = 0;
+  for (state_number s = 0; s < nstates; ++s)
+    for (size_t k = 0; k < tally[s]; ++k)
+      {
+        base_number v = (tos[s][k] == ACTION_NUMBER_MINIMUM
+                         ? table_ninf : tos[s][k]);
+        if (v < action_min)
+          action_min = v;
+        if (action_max < v)
+          action_max = v;
+      }
+
+  if (tables_encoding != table_encoding_packed)
+    {
+      int nrows = (tables_encoding == table_encoding_dense
+                   ? state_number_as_int (nstates) : nactrows);
+      yyaction = xcalloc ((size_t) nrows * ntokens, sizeof *yyaction);
+      for (state_number s = 0; s < nstates; ++s)
+        {
+          base_number *row
+            = yyaction + (size_t) ntokens * (tables_encoding
+                                             == table_encoding_dense
+                                             ? s : yyactrow[s]);
+          for (size_t k = 0; k < tally[s]; ++k)
+            row[froms[s][k]] = (tos[s][k] == ACTION_NUMBER_MINIMUM
+                                ? table_ninf : tos[s][k]);
+        }
+    }
+}
+
+
 /*-----------------------------------------------------------------.
 | Compute and output yydefact, yydefgoto, yypact, yypgoto, yytable |
 | and yycheck.                                                     |
 `-----------------------------------------------------------------*/
 
+void
+tables_encoding_init (void)
+{
+  char *encoding = muscle_percent_define_get ("api.table.encoding");
+  tables_encoding =
+    STREQ (encoding, "dense") ? table_encoding_dense
+    : STREQ (encoding, "two-level") ? table_encoding_two_level
+    : table_encoding_packed;
+  free (encoding);
+}
+
 void
 tables_generate (void)
 {
@@ -783,6 +974,12 @@ tables_generate (void)
   verify (sizeof nvars <= sizeof nvectors);
 
   nvectors = state_number_as_int (nstates) + nvars;
+  tables_encoding_init ();
+
+  yystos = xnmalloc (nstates, sizeof *yystos);
+  for (state_number i = 0; i < nstates; ++i)
+    yystos[i] = states[i]->accessing_symbol;
+  yyfinal = final_state->number;
 
   froms = xcalloc (nvectors, sizeof *froms);
   tos = xcalloc (nvectors, sizeof *tos);
@@ -793,14 +990,20 @@ tables_generate (void)
   token_actions ();
 
   goto_actions ();
-  free (goto_map);
-  free (from_state);
-  free (to_state);
+  goto_map_free ();
 
   order = xcalloc (nvectors, sizeof *order);
   sort_actions ();
   pack_table ();
   free (order);
+  action_rows_compute ();
+
+  profile_count ("nvectors", nvectors);
+  profile_count ("nentries", nentries);
+  profile_count ("table_size", table_size);
+  profile_count ("high", high);
+  profile_count ("lowzero", lowzero);
+  profile_count ("conflict_list_cnt", conflict_list_cnt);
 
   free (tally);
   free (width);
@@ -818,6 +1021,63 @@ tables_generate (void)
 }
 
 
+/* The size of the elements of a table whose values range from MIN to
+   MAX, as chosen by b4_int_type in the skeletons.  */
+static size_t
+int_type_size (int min, int max)
+{
+  return ((-127 <= min && max <= 127) || (0 <= min && max <= 255)
+          ? 1
+          : (-32767 <= min && max <= 32767) || (0 <= min && max <= 65535)
+          ? 2
+          : sizeof (int));
+}
+
+/* The size in bytes of TAB[0..SIZE[ in the parser.  */
+static size_t
+table_bytes (int const *tab, size_t size)
+{
+  if (!size)
+    return 0;
+  int min = tab[0];
+  int max = tab[0];
+  for (size_t i = 1; i < size; ++i)
+    {
+      if (tab[i] < min)
+        min = tab[i];
+      if (max < tab[i])
+        max = tab[i];
+    }
+  return size * int_type_size (min, max);
+}
+
+void
+tables_print_sizes (FILE *out)
+{
+  size_t packed = (table_bytes (base, nstates)
+                   + table_bytes (yydefact, nstates)
+                   + table_bytes (base + nstates, nvars)
+                   + table_bytes (yydefgoto, nvars)
+                   + table_bytes (table, high + 1)
+                   + table_bytes (check, high + 1));
+
+  size_t action_size = int_type_size (action_min, action_max);
+  size_t dense = (size_t) nstates * ntokens * action_size;
+  size_t two_level = ((size_t) nactrows * ntokens * action_size
+                      + table_bytes (yyactrow, nstates));
+
+  fputs (_("Parser Tables"), out);
+  fputs ("\n\n", out);
+  fprintf (out, "    %-10s %10zu\n", "packed", packed);
+  fprintf (out, "    %-10s %10zu\n", "dense", packed + dense);
+  fprintf (out, "    %-10s %10zu\n", "two-level", packed + two_level);
+  fputc ('\n', out);
+  fprintf (out, _("    %d distinct action rows for %d states"),
+           nactrows, nstates);
+  fputs ("\n\n", out);
+}
+
+
 /*-------------------------.
 | Free the parser tables.  |
 `-------------------------*/
@@ -832,4 +1092,7 @@ tables_free (void)
   free (check);
   free (yydefgoto);
   free (yydefact);
+  free (yyaction);
+  free (yyactrow);
+  free (yystos);
 }
@@ -136,7 +136,45 @@ extern state_number *yydefgoto;
 extern rule_number *yydefact;
 extern int high;
 
+/* YYSTOS[S] is the symbol that accesses state S, and YYFINAL the
+   number of the final state.  Unlike the automaton, they are kept
+   until the output is complete.  */
+extern symbol_number *yystos;
+extern state_number yyfinal;
+
+/* The encoding of the action tables (%define api.table.encoding).  */
+typedef enum
+  {
+    /* YYPACT, YYTABLE, YYCHECK and YYDEFACT only.  */
+    table_encoding_packed,
+    /* Also a direct YYACTION matrix, one row per state.  */
+    table_encoding_dense,
+    /* Also YYACTION with identical rows shared, and YYACTROW.  */
+    table_encoding_two_level
+  } table_encoding;
+
+extern table_encoding tables_encoding;
+
+/* YYACTROW[S] is the number of the action row of state S: states with
+   the same actions share the same row.  There are NACTROWS distinct
+   rows.
+
+   Unless the encoding is packed, YYACTION[R * NTOKENS + I] is the
+   action on token I in the states of row R (with the dense encoding,
+   the row of state S is S).  Actions are encoded as in YYTABLE, and 0
+   stands for the default action (YYDEFACT).  */
+extern base_number *yyaction;
+extern int *yyactrow;
+extern int nactrows;
+
+/* Set TABLES_ENCODING from %define api.table.encoding.  */
+void tables_encoding_init (void);
+
 void tables_generate (void);
+
+/* Report the size of the parser tables with each encoding.  */
+void tables_print_sizes (FILE *out);
+
 void tables_free (void);
 
 #endif /* !TABLES_H_ */